@@ -26,6 +26,8 @@
 
 #include "sash.h"
 
+#if	CMD_AR
+
 
 /*
  * Structure to hold information about the archive file.
@@ -76,7 +78,7 @@ static BOOL	getNumber(const char * s, unsigned base, int max_digits,
 			unsigned long * ul);
 
 
-void
+int
 do_ar(int argc, const char ** argv)
 {
 	const char *	options;
@@ -87,6 +89,8 @@ do_ar(int argc, const char ** argv)
 	BOOL		verbose;
 	Archive		arch;
 
+	clearDirCache();
+
 	verbose = FALSE;
 	doExtract = FALSE;
 	doTable = FALSE;
@@ -96,7 +100,7 @@ do_ar(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Too few arguments for ar\n");
 
-		return;
+		return 1;
 	}
 
 	/*
@@ -137,12 +141,12 @@ do_ar(int argc, const char ** argv)
 		case 'd': case 'm': case 'q': case 'r':
 			fprintf(stderr, "Writing ar files is not supported\n");
 
-			return;
+			return 1;
 
 		default:
 			fprintf(stderr, "Unknown ar flag: %c\n", *options);
 
-			return;
+			return 1;
 		}
 	}
 
@@ -151,7 +155,7 @@ do_ar(int argc, const char ** argv)
 		fprintf(stderr,
 			"Exactly one of 'x', 'p' or 't' must be specified\n");
 
-		return;
+		return 1;
 	}
 
 	/*
@@ -160,13 +164,13 @@ do_ar(int argc, const char ** argv)
 	initArchive(&arch);
 
 	if (!openArchive(archiveName, &arch))
-		return;
+		return 1;
 
 	/*
 	 * Read the first special member of the archive.
 	 */
 	if (!readSpecialMember(&arch))
-		return;
+		return 1;
 
 	/*
 	 * Read all of the normal members of the archive.
@@ -247,6 +251,8 @@ do_ar(int argc, const char ** argv)
 	}
 
 	closeArchive(&arch);
+
+	return 0;
 }
 
 
@@ -260,7 +266,7 @@ createFile(const Archive * arch)
 {
 	int	fd;
 
-	fd = open(arch->name, O_WRONLY | O_CREAT | O_TRUNC, arch->mode);
+	fd = openFile(arch->name, O_WRONLY | O_CREAT | O_TRUNC, arch->mode);
 
 	if (fd == -1)
 	{
@@ -391,7 +397,7 @@ openArchive(const char * name, Archive * arch)
 	unsigned char	buf[SARMAG];
 	ssize_t		cc;
 
-	arch->fd = open(name, O_RDONLY);
+	arch->fd = openFile(name, O_RDONLY, 0);
 
 	if (arch->fd == -1)
 	{
@@ -1007,5 +1013,6 @@ listMember(const Archive * arch)
 	       arch->name);
 }
 
+#endif
 
 /* END CODE */
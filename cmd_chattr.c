@@ -16,12 +16,14 @@
 
 #include "sash.h"
 
+#if	CMD_CHATTR
+
 
 /*
  * The chattr command.
  * This can turn on or off the immutable and append-only ext2 flags.
  */
-void
+int
 do_chattr(int argc, const char ** argv)
 {
 	const char *	fileName;
@@ -32,7 +34,9 @@ do_chattr(int argc, const char ** argv)
 	int		oldFlags;
 	int		newFlags;
 	int		fd;
+	int		r;
 
+	r = 0;
 	argc--;
 	argv++;
 
@@ -74,7 +78,7 @@ do_chattr(int argc, const char ** argv)
 					fprintf(stderr, "Unknown flag '%c'\n",
 						options[-1]);
 
-					return;
+					return 1;
 			}
 		}
 	}
@@ -86,14 +90,14 @@ do_chattr(int argc, const char ** argv)
 	{
 		fprintf(stderr, "No attributes specified\n");
 
-		return;
+		return 1;
 	}
 
 	if ((onFlags & offFlags) != 0)
 	{
 		fprintf(stderr, "Inconsistent attributes specified\n");
 
-		return;
+		return 1;
 	}
 
 	/*
@@ -103,7 +107,7 @@ do_chattr(int argc, const char ** argv)
 	{
 		fprintf(stderr, "No files specified for setting attributes\n");
 
-		return;
+		return 1;
 	}
 
 	/*
@@ -116,11 +120,12 @@ do_chattr(int argc, const char ** argv)
 		/*
 		 * Open the file name.
 		 */
-		fd = open(fileName, O_RDONLY | O_NONBLOCK);
+		fd = openFile(fileName, O_RDONLY | O_NONBLOCK, 0);
 
 		if (fd < 0)
 		{
 			perror(fileName);
+			r = 1;
 
 			continue;
 		}
@@ -131,6 +136,7 @@ do_chattr(int argc, const char ** argv)
 		if (ioctl(fd, EXT2_IOC_GETFLAGS, &oldFlags) < 0)
 		{
 			perror(fileName);
+			r = 1;
 
 			(void) close(fd);
 
@@ -161,6 +167,7 @@ do_chattr(int argc, const char ** argv)
 		if (ioctl(fd, EXT2_IOC_SETFLAGS, &newFlags) < 0)
 		{
 			perror(fileName);
+			r = 1;
 
 			(void) close(fd);
 
@@ -172,6 +179,8 @@ do_chattr(int argc, const char ** argv)
 		 */
 		(void) close(fd);
 	}
+
+	return r;
 }
 
 
@@ -179,15 +188,17 @@ do_chattr(int argc, const char ** argv)
  * The lsattr command.
  * This lists the immutable and append-only ext2 flags.
  */
-void
+int
 do_lsattr(int argc, const char ** argv)
 {
 	const char *	fileName;
 	int		fd;
 	int		status;
 	int		flags;
+	int		r;
 	char		string[4];
 
+	r = 0;
 	argc--;
 	argv++;
 
@@ -201,11 +212,12 @@ do_lsattr(int argc, const char ** argv)
 		/*
 		 * Open the file name.
 		 */
-		fd = open(fileName, O_RDONLY | O_NONBLOCK);
+		fd = openFile(fileName, O_RDONLY | O_NONBLOCK, 0);
 
 		if (fd < 0)
 		{
 			perror(fileName);
+			r = 1;
 
 			continue;
 		}
@@ -223,6 +235,7 @@ do_lsattr(int argc, const char ** argv)
 		if (status < 0)
 		{
 			perror(fileName);
+			r = 1;
 
 			continue;
 		}
@@ -240,9 +253,13 @@ do_lsattr(int argc, const char ** argv)
 		 */
 		printf("%s  %s\n", string, fileName);
 	}
+
+	return r;
 }
 
 #endif
 
+#endif
+
 
 /* END CODE */
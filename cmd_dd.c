@@ -8,6 +8,8 @@
 
 #include "sash.h"
 
+#if	CMD_DD
+
 
 #define	PAR_NONE	0
 #define	PAR_IF		1
@@ -40,7 +42,7 @@ static const PARAM	params[] =
 static	long	getNum(const char * cp);
 
 
-void
+int
 do_dd(int argc, const char ** argv)
 {
 	const char *	str;
@@ -53,6 +55,7 @@ do_dd(int argc, const char ** argv)
 	int		inCc;
 	int		outCc;
 	int		blockSize;
+	int		r;
 	long		count;
 	long		seekVal;
 	long		skipVal;
@@ -61,6 +64,8 @@ do_dd(int argc, const char ** argv)
 	char *		buf;
 	char		localBuf[BUF_SIZE];
 
+	clearDirCache();
+
 	inFile = NULL;
 	outFile = NULL;
 	seekVal = 0;
@@ -77,7 +82,7 @@ do_dd(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Bad dd argument\n");
 
-			return;
+			return 1;
 		}
 
 		*cp++ = '\0';
@@ -95,7 +100,7 @@ do_dd(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Multiple input files illegal\n");
 
-					return;
+					return 1;
 				}
 	
 				inFile = cp;
@@ -106,7 +111,7 @@ do_dd(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Multiple output files illegal\n");
 
-					return;
+					return 1;
 				}
 
 				outFile = cp;
@@ -119,7 +124,7 @@ do_dd(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Bad block size value\n");
 
-					return;
+					return 1;
 				}
 
 				break;
@@ -131,7 +136,7 @@ do_dd(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Bad count value\n");
 
-					return;
+					return 1;
 				}
 
 				break;
@@ -143,7 +148,7 @@ do_dd(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Bad seek value\n");
 
-					return;
+					return 1;
 				}
 
 				break;
@@ -155,7 +160,7 @@ do_dd(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Bad skip value\n");
 
-					return;
+					return 1;
 				}
 
 				break;
@@ -163,7 +168,7 @@ do_dd(int argc, const char ** argv)
 			default:
 				fprintf(stderr, "Unknown dd parameter\n");
 
-				return;
+				return 1;
 		}
 	}
 
@@ -171,14 +176,14 @@ do_dd(int argc, const char ** argv)
 	{
 		fprintf(stderr, "No input file specified\n");
 
-		return;
+		return 1;
 	}
 
 	if (outFile == NULL)
 	{
 		fprintf(stderr, "No output file specified\n");
 
-		return;
+		return 1;
 	}
 
 	buf = localBuf;
@@ -191,14 +196,15 @@ do_dd(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Cannot allocate buffer\n");
 
-			return;
+			return 1;
 		}
 	}
 
 	intotal = 0;
 	outTotal = 0;
+	r = 1;
 
-	inFd = open(inFile, 0);
+	inFd = openFile(inFile, O_RDONLY, 0);
 
 	if (inFd < 0)
 	{
@@ -207,10 +213,10 @@ do_dd(int argc, const char ** argv)
 		if (buf != localBuf)
 			free(buf);
 
-		return;
+		return 1;
 	}
 
-	outFd = creat(outFile, 0666);
+	outFd = openFile(outFile, O_WRONLY | O_CREAT | O_TRUNC, 0666);
 
 	if (outFd < 0)
 	{
@@ -220,7 +226,7 @@ do_dd(int argc, const char ** argv)
 		if (buf != localBuf)
 			free(buf);
 
-		return;
+		return 1;
 	}
 
 	if (skipVal)
@@ -285,12 +291,17 @@ do_dd(int argc, const char ** argv)
 
 	if (inCc < 0)
 		perror(inFile);
+	else
+		r = 0;
 
 cleanup:
 	close(inFd);
 
 	if (close(outFd) < 0)
+	{
 		perror(outFile);
+		r = 1;
+	}
 
 	if (buf != localBuf)
 		free(buf);
@@ -300,6 +311,8 @@ cleanup:
 
 	printf("%ld+%d records out\n", outTotal / blockSize,
 		(outTotal % blockSize) != 0);
+
+	return r;
 }
 
 
@@ -347,4 +360,6 @@ getNum(const char * cp)
 	return value;
 }
 
+#endif
+
 /* END CODE */
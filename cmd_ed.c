@@ -8,6 +8,8 @@
 
 #include "sash.h"
 
+#if	CMD_ED
+
 #define	USERSIZE	1024	/* max line length typed in by user */
 #define	INITBUF_SIZE	1024	/* initial buffer size */
 
@@ -60,11 +62,13 @@ static	LEN	findString
 	(const LINE * lp, const char * str, LEN len, LEN offset);
 
 
-void
+int
 do_ed(int argc, const char ** argv)
 {
+	clearDirCache();
+
 	if (!initEdit())
-		return;
+		return 1;
 
 	if (argc > 1)
 	{
@@ -75,14 +79,14 @@ do_ed(int argc, const char ** argv)
 			fprintf(stderr, "No memory\n");
 			termEdit();
 
-			return;
+			return 1;
 		}
 
 		if (!readLines(fileName, 1))
 		{
 			termEdit();
 
-			return;
+			return 1;
 		}
 
 		if (lastNum)
@@ -94,6 +98,8 @@ do_ed(int argc, const char ** argv)
 	doCommands();
 
 	termEdit();
+
+	return 0;
 }
 
 
@@ -922,7 +928,7 @@ readLines(const char * file, NUM num)
 		return FALSE;
 	}
 
-	fd = open(file, 0);
+	fd = openFile(file, O_RDONLY, 0);
 
 	if (fd < 0)
 	{
@@ -1054,7 +1060,7 @@ writeLines(const char * file, NUM num1, NUM num2)
 	lineCount = 0;
 	charCount = 0;
 
-	fd = creat(file, 0666);
+	fd = openFile(file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
 
 	if (fd < 0) {
 		perror(file);
@@ -1433,4 +1439,6 @@ setCurNum(NUM num)
 	return TRUE;
 }
 
+#endif
+
 /* END CODE */
@@ -13,11 +13,13 @@
 
 #include "sash.h"
 
+#if	CMD_FILE
+
 
 static const char *	checkFile(const char * name);
 
 
-void
+int
 do_file(int argc, const char ** argv)
 {
 	const char *	name;
@@ -37,6 +39,8 @@ do_file(int argc, const char ** argv)
 
 		printf("%s: %s\n", name, info);
 	}
+
+	return 0;
 }
 
 
@@ -122,7 +126,7 @@ checkFile(const char * name)
 	 * The file is a normal file.
 	 * Open it if we can and read in the first block.
 	 */
-	fd = open(name, O_RDONLY);
+	fd = openFile(name, O_RDONLY, 0);
 
 	if (fd < 0)
 	{
@@ -230,4 +234,6 @@ checkFile(const char * name)
 	return info;
 }
 
+#endif
+
 /* END CODE */
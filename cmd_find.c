@@ -13,6 +13,8 @@
 
 #include "sash.h"
 
+#if	CMD_FIND
+
 
 #ifdef	S_ISLNK
 #define	LSTAT	lstat
@@ -46,7 +48,7 @@ static	BOOL	testFile(const char * fullName, const struct stat * statBuf);
  * Find files from the specified directory path.
  * This is limited to just printing their file names.
  */
-void
+int
 do_find(int argc, const char ** argv)
 {
 	const char *	cp;
@@ -65,7 +67,7 @@ do_find(int argc, const char ** argv)
 	{
 		fprintf(stderr, "No path specified\n");
 
-		return;
+		return 1;
 	}
 
 	path = *argv++;
@@ -84,7 +86,7 @@ do_find(int argc, const char ** argv)
 			{
 				fprintf(stderr, "Missing type string\n");
 
-				return;
+				return 1;
 			}
 
 			argc--;
@@ -96,7 +98,7 @@ do_find(int argc, const char ** argv)
 			{
 				fprintf(stderr, "Missing file name\n");
 
-				return;
+				return 1;
 			}
 
 			argc--;
@@ -108,7 +110,7 @@ do_find(int argc, const char ** argv)
 			{
 				fprintf(stderr, "Missing file size\n");
 
-				return;
+				return 1;
 			}
 
 			argc--;
@@ -123,7 +125,7 @@ do_find(int argc, const char ** argv)
 			{
 				fprintf(stderr, "Bad file size specified\n");
 
-				return;
+				return 1;
 			}
 		}
 		else
@@ -133,7 +135,7 @@ do_find(int argc, const char ** argv)
 			else
 				fprintf(stderr, "Unknown option\n");
 
-			return;
+			return 1;
 		}
 	}
 
@@ -146,14 +148,14 @@ do_find(int argc, const char ** argv)
 		fprintf(stderr, "Cannot stat \"%s\": %s\n", path,
 			strerror(errno));
 
-		return;
+		return 1;
 	}
 
 	if (!S_ISDIR(statBuf.st_mode))
 	{
 		fprintf(stderr, "Path \"%s\" is not a directory\n", path);
 
-		return;
+		return 1;
 	}
 
 	/*
@@ -171,6 +173,8 @@ do_find(int argc, const char ** argv)
 	 * Now examine the files in the directory.
 	 */
 	examineDirectory(path);
+
+	return 0;
 }
 
 
@@ -189,7 +193,7 @@ examineDirectory(const char * path)
 	/*
 	 * Open the directory.
 	 */
-	dir = opendir(path);
+	dir = openDir(path);
 
 	if (dir == NULL)
 	{
@@ -371,4 +375,6 @@ testFile(const char * fullName, const struct stat * statBuf)
 	return TRUE;
 }
 
+#endif
+
 /* END CODE */
@@ -10,12 +10,17 @@
 
 #include "sash.h"
 
+#if	CMD_GREP
+
 
 static	BOOL	search
 	(const char * string, const char * word, BOOL ignoreCase);
 
 
-void
+static	const char *	stdinName = "(standard input)";
+
+
+int
 do_grep(int argc, const char ** argv)
 {
 	FILE *		fp;
@@ -25,11 +30,15 @@ do_grep(int argc, const char ** argv)
 	BOOL		tellName;
 	BOOL		ignoreCase;
 	BOOL		tellLine;
+	BOOL		found;
 	long		line;
+	int		r;
 	char		buf[BUF_SIZE];
 
 	ignoreCase = FALSE;
 	tellLine = FALSE;
+	found = FALSE;
+	r = 0;
 
 	argc--;
 	argv++;
@@ -52,7 +61,7 @@ do_grep(int argc, const char ** argv)
 			default:
 				fprintf(stderr, "Unknown option\n");
 
-				return;
+				return 2;
 		}
 	}
 
@@ -61,15 +70,28 @@ do_grep(int argc, const char ** argv)
 
 	tellName = (argc > 1);
 
+	/*
+	 * If no files are given then search the standard input.
+	 */
+	if (argc == 0)
+	{
+		argc = 1;
+		argv = &stdinName;
+	}
+
 	while (argc-- > 0)
 	{
 		name = *argv++;
 
-		fp = fopen(name, "r");
+		if (name == stdinName)
+			fp = stdin;
+		else
+			fp = fopenFile(name, "r");
 
 		if (fp == NULL)
 		{
 			perror(name);
+			r = 2;
 
 			continue;
 		}
@@ -80,9 +102,10 @@ do_grep(int argc, const char ** argv)
 		{
 			if (intFlag)
 			{
-				fclose(fp);
+				if (fp != stdin)
+					fclose(fp);
 
-				return;
+				return 2;
 			}
 
 			line++;
@@ -94,6 +117,8 @@ do_grep(int argc, const char ** argv)
 
 			if (search(buf, word, ignoreCase))
 			{
+				found = TRUE;
+
 				if (tellName)
 					printf("%s: ", name);
 
@@ -105,10 +130,19 @@ do_grep(int argc, const char ** argv)
 		}
 
 		if (ferror(fp))
+		{
 			perror(name);
+			r = 2;
+		}
 
-		fclose(fp);
+		if (fp != stdin)
+			fclose(fp);
 	}
+
+	if (r == 0)
+		r = found ? 0 : 1;
+
+	return r;
 }
 
 
@@ -188,4 +222,6 @@ search(const char * string, const char * word, BOOL ignoreCase)
 	}
 }
 
+#endif
+
 /* END CODE */
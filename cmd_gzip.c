@@ -18,6 +18,8 @@
 
 #include "sash.h"
 
+#if	CMD_GZIP
+
 
 #define	GZ_EXT		".gz"
 #define	TGZ_EXT		".tgz"
@@ -62,14 +64,18 @@ static const char * convertName
 	(const CONVERT * table, const char * inFile);
 
 
-void
+int
 do_gzip(int argc, const char ** argv)
 {
 	const char *	outPath;
 	const char *	inFile;
 	const char *	outFile;
 	int		i;
+	int		r;
+
+	clearDirCache();
 
+	r = 0;
 	argc--;
 	argv++;
 
@@ -99,7 +105,7 @@ do_gzip(int argc, const char ** argv)
 			else
 				fprintf(stderr, "Illegal option\n");
 
-			return;
+			return 1;
 		}
 	}
 	
@@ -120,7 +126,11 @@ do_gzip(int argc, const char ** argv)
 			 * Try to compress the file.
 			 */
 			if (!gzip(inFile, outFile))
+			{
+				r = 1;
+
 				continue;
+			}
 
 			/*
 			 * This was successful.
@@ -130,10 +140,11 @@ do_gzip(int argc, const char ** argv)
 			{
 				fprintf(stderr, "%s: %s\n", inFile,
 					"Compressed ok but unlink failed");
+				r = 1;
 			}
 		}
 
-		return;
+		return r;
 	}
 
 	/*
@@ -144,12 +155,14 @@ do_gzip(int argc, const char ** argv)
 	 */
 	if (!isDirectory(outPath))
 	{
-		if (argc == 1)
-			(void) gzip(*argv, outPath);
-		else
+		if (argc != 1)
+		{
 			fprintf(stderr, "Exactly one input file is required\n");
 
-		return;
+			return 1;
+		}
+
+		return gzip(*argv, outPath) ? 0 : 1;
 	}
 
 	/*
@@ -187,19 +200,26 @@ do_gzip(int argc, const char ** argv)
 		/*
 		 * Compress the input file without deleting the input file.
 		 */
-		(void) gzip(inFile, outFile);
+		if (!gzip(inFile, outFile))
+			r = 1;
 	}
+
+	return r;
 }
 
 
-void
+int
 do_gunzip(int argc, const char ** argv)
 {
 	const char *	outPath;
 	const char *	inFile;
 	const char *	outFile;
 	int		i;
+	int		r;
+
+	clearDirCache();
 
+	r = 0;
 	argc--;
 	argv++;
 
@@ -229,7 +249,7 @@ do_gunzip(int argc, const char ** argv)
 			else
 				fprintf(stderr, "Illegal option\n");
 
-			return;
+			return 1;
 		}
 	}
 	
@@ -251,6 +271,7 @@ do_gunzip(int argc, const char ** argv)
 			{
 				fprintf(stderr, "%s: %s\n", inFile,
 					"missing compression extension");
+				r = 1;
 
 				continue;
 			}
@@ -259,7 +280,11 @@ do_gunzip(int argc, const char ** argv)
 			 * Try to uncompress the file.
 			 */
 			if (!gunzip(inFile, outFile))
+			{
+				r = 1;
+
 				continue;
+			}
 
 			/*
 			 * This was successful.
@@ -269,10 +294,11 @@ do_gunzip(int argc, const char ** argv)
 			{
 				fprintf(stderr, "%s: %s\n", inFile,
 					"Uncompressed ok but unlink failed");
+				r = 1;
 			}
 		}
 
-		return;
+		return r;
 	}
 
 	/*
@@ -283,9 +309,12 @@ do_gunzip(int argc, const char ** argv)
 	if (isDevice(outPath))
 	{
 		while (!intFlag && (argc-- > 0))
-			(void) gunzip(*argv++, outPath);
+		{
+			if (!gunzip(*argv++, outPath))
+				r = 1;
+		}
 
-		return;
+		return r;
 	}
 
 	/*
@@ -295,12 +324,14 @@ do_gunzip(int argc, const char ** argv)
 	 */
 	if (!isDirectory(outPath))
 	{
-		if (argc == 1)
-			(void) gunzip(*argv, outPath);
-		else
+		if (argc != 1)
+		{
 			fprintf(stderr, "Exactly one input file is required\n");
 
-		return;
+			return 1;
+		}
+
+		return gunzip(*argv, outPath) ? 0 : 1;
 	}
 
 	/*
@@ -338,8 +369,11 @@ do_gunzip(int argc, const char ** argv)
 		/*
 		 * Uncompress the input file without deleting the input file.
 		 */
-		(void) gunzip(inFile, outFile);
+		if (!gunzip(inFile, outFile))
+			r = 1;
 	}
+
+	return r;
 }
 
 
@@ -391,7 +425,7 @@ gzip(const char * inputFileName, const char * outputFileName)
 	/*
 	 * Open the input file.
 	 */
-	inFD = open(inputFileName, O_RDONLY);
+	inFD = openFile(inputFileName, O_RDONLY, 0);
 
 	if (inFD < 0)
 	{
@@ -539,9 +573,10 @@ gunzip(const char * inputFileName, const char * outputFileName)
 	 * Create the output file.
 	 */
 	if (isDevice(outputFileName))
-		outFD = open(outputFileName, O_WRONLY);
+		outFD = openFile(outputFileName, O_WRONLY, 0);
 	else
-		outFD = open(outputFileName, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+		outFD = openFile(outputFileName, O_WRONLY|O_CREAT|O_TRUNC,
+			0666);
 
 	if (outFD < 0)
 	{
@@ -666,6 +701,8 @@ convertName(const CONVERT * table, const char * inputFile)
 }
 
 
+#endif
+
 #endif
 
 /* END CODE */
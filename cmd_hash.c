@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The cache of program locations found using the PATH environment
+ * variable, and the "hash" built-in command which manages it.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "sash.h"
+
+
+#define	PROGRAM_HASH_SIZE	64
+
+
+/*
+ * One directory of the PATH list, along with its modification time
+ * as it was when it was last searched.  A zero time means that the
+ * directory has not been searched yet.
+ */
+typedef struct
+{
+	const char *	name;
+	time_t		mtime;
+	long		mtimeNsec;
+} PathDir;
+
+
+/*
+ * One remembered program location.
+ */
+typedef	struct	program	PROGRAM;
+
+struct	program
+{
+	PROGRAM *	next;
+	char *		name;
+	char *		path;
+	int		dirIndex;
+	long		hits;
+};
+
+
+/*
+ * The PATH value that the directory list was built from.
+ */
+static	char *		pathValue;
+static	char *		pathStrings;
+static	const char **	pathNames;
+static	PathDir *	pathDirs;
+static	int		pathDirCount;
+
+static	PROGRAM *	programHash[PROGRAM_HASH_SIZE];
+
+
+static	BOOL	checkPath(void);
+static	BOOL	dirChanged(int dirIndex);
+static	void	flushPrograms(int dirIndex);
+static	const char *	searchPath(const char * name, int * dirIndexPtr);
+
+
+/*
+ * Return the full path of a program which would be executed using
+ * the PATH environment variable, using the remembered location if
+ * it is still valid.  Names containing a slash are returned unchanged.
+ * The returned path is only valid until the next call.
+ * Returns NULL if the program cannot be found.
+ */
+const char *
+findProgram(const char * name)
+{
+	PROGRAM *	program;
+	PROGRAM **	bucket;
+	const char *	path;
+	int		dirIndex;
+	int		i;
+
+	if (strchr(name, '/'))
+		return name;
+
+	if (!checkPath())
+		return NULL;
+
+	bucket = &programHash[hashName(name, strlen(name)) %
+		PROGRAM_HASH_SIZE];
+
+	for (program = *bucket; program; program = program->next)
+	{
+		if (strcmp(program->name, name) == 0)
+			break;
+	}
+
+	/*
+	 * If the program is remembered, then make sure that none of the
+	 * directories up to and including the one it was found in have
+	 * changed, since the program could have been removed or else
+	 * been added to an earlier directory.
+	 */
+	if (program)
+	{
+		for (i = 0; i <= program->dirIndex; i++)
+		{
+			if (dirChanged(i))
+			{
+				flushPrograms(i);
+				program = NULL;
+
+				break;
+			}
+		}
+	}
+
+	if (program)
+	{
+		program->hits++;
+
+		return program->path;
+	}
+
+	path = searchPath(name, &dirIndex);
+
+	if (path == NULL)
+		return NULL;
+
+	/*
+	 * Programs found in relative directories depend on the current
+	 * directory, so they are not remembered.
+	 */
+	if (*pathDirs[dirIndex].name != '/')
+		return path;
+
+	program = (PROGRAM *) malloc(sizeof(PROGRAM));
+
+	if (program == NULL)
+		return path;
+
+	program->name = strdup(name);
+	program->path = strdup(path);
+
+	if ((program->name == NULL) || (program->path == NULL))
+	{
+		free(program->name);
+		free(program->path);
+		free((char *) program);
+
+		return path;
+	}
+
+	program->dirIndex = dirIndex;
+	program->hits = 1;
+	program->next = *bucket;
+	*bucket = program;
+
+	return program->path;
+}
+
+
+/*
+ * Forget all of the remembered program locations.
+ * This is done when the PATH environment variable is changed.
+ */
+void
+clearProgramCache(void)
+{
+	flushPrograms(0);
+
+	free(pathValue);
+	free(pathStrings);
+	free((char *) pathNames);
+	free((char *) pathDirs);
+
+	pathValue = NULL;
+	pathStrings = NULL;
+	pathNames = NULL;
+	pathDirs = NULL;
+	pathDirCount = 0;
+}
+
+
+/*
+ * Return the NULL terminated list of directories in the PATH
+ * environment variable, with null directories converted to ".".
+ * Returns NULL on an allocation failure.
+ */
+const char **
+getPathDirs(void)
+{
+	if (!checkPath())
+		return NULL;
+
+	return pathNames;
+}
+
+
+int
+do_hash(int argc, const char ** argv)
+{
+	PROGRAM *	program;
+	int		i;
+	int		r;
+
+	argc--;
+	argv++;
+
+	if ((argc > 0) && (strcmp(*argv, "-r") == 0))
+	{
+		clearProgramCache();
+
+		return 0;
+	}
+
+	/*
+	 * If programs are named, then just remember their locations.
+	 */
+	if (argc > 0)
+	{
+		r = 0;
+
+		while (argc-- > 0)
+		{
+			if (findProgram(*argv) == NULL)
+			{
+				fprintf(stderr, "%s: not found\n", *argv);
+				r = 1;
+			}
+
+			argv++;
+		}
+
+		return r;
+	}
+
+	/*
+	 * List the remembered programs.
+	 */
+	for (i = 0; i < PROGRAM_HASH_SIZE; i++)
+	{
+		for (program = programHash[i]; program; program = program->next)
+			printf("%5ld  %s\n", program->hits, program->path);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Make sure that the list of PATH directories matches the current
+ * value of the PATH environment variable, rebuilding it and forgetting
+ * all remembered programs if it has changed.
+ * Returns TRUE if the list is valid.
+ */
+static BOOL
+checkPath(void)
+{
+	const char *	path;
+	char *		cp;
+	int		count;
+
+	path = getenv("PATH");
+
+	if (path == NULL)
+		path = "";
+
+	if (pathValue && (strcmp(path, pathValue) == 0))
+		return TRUE;
+
+	clearProgramCache();
+
+	count = 1;
+
+	for (cp = (char *) path; *cp; cp++)
+	{
+		if (*cp == ':')
+			count++;
+	}
+
+	pathValue = strdup(path);
+	pathStrings = strdup(path);
+	pathNames = (const char **) malloc(sizeof(char *) * (count + 1));
+	pathDirs = (PathDir *) calloc(count, sizeof(PathDir));
+
+	if ((pathValue == NULL) || (pathStrings == NULL) ||
+		(pathNames == NULL) || (pathDirs == NULL))
+	{
+		fprintf(stderr, "No memory for PATH directories\n");
+		clearProgramCache();
+
+		return FALSE;
+	}
+
+	/*
+	 * Break the path up into its directories.
+	 */
+	for (cp = pathStrings; cp; pathDirCount++)
+	{
+		pathNames[pathDirCount] = cp;
+
+		if ((*cp == ':') || (*cp == '\0'))
+			pathNames[pathDirCount] = ".";
+
+		pathDirs[pathDirCount].name = pathNames[pathDirCount];
+
+		cp = strchr(cp, ':');
+
+		if (cp)
+			*cp++ = '\0';
+	}
+
+	pathNames[pathDirCount] = NULL;
+
+	return TRUE;
+}
+
+
+/*
+ * Check whether a PATH directory has been modified since it was last
+ * searched, remembering its new modification time if so.
+ */
+static BOOL
+dirChanged(int dirIndex)
+{
+	PathDir *	dir;
+	struct stat	statBuf;
+
+	dir = &pathDirs[dirIndex];
+
+	if (stat(dir->name, &statBuf) < 0)
+	{
+		statBuf.st_mtim.tv_sec = 0;
+		statBuf.st_mtim.tv_nsec = 0;
+	}
+
+	if ((dir->mtime == statBuf.st_mtim.tv_sec) &&
+		(dir->mtimeNsec == statBuf.st_mtim.tv_nsec))
+	{
+		return FALSE;
+	}
+
+	dir->mtime = statBuf.st_mtim.tv_sec;
+	dir->mtimeNsec = statBuf.st_mtim.tv_nsec;
+
+	return TRUE;
+}
+
+
+/*
+ * Forget the remembered programs which were found in the specified
+ * PATH directory or in any later one.
+ */
+static void
+flushPrograms(int dirIndex)
+{
+	PROGRAM *	program;
+	PROGRAM **	link;
+	int		i;
+
+	for (i = 0; i < PROGRAM_HASH_SIZE; i++)
+	{
+		link = &programHash[i];
+
+		while ((program = *link) != NULL)
+		{
+			if (program->dirIndex < dirIndex)
+			{
+				link = &program->next;
+
+				continue;
+			}
+
+			*link = program->next;
+
+			free(program->name);
+			free(program->path);
+			free((char *) program);
+		}
+	}
+}
+
+
+/*
+ * Search the PATH directories for an executable program, remembering
+ * the modification times of the directories as they are searched.
+ * Returns the full path in a static buffer and the index of the
+ * directory it was found in, or NULL if it was not found.
+ */
+static const char *
+searchPath(const char * name, int * dirIndexPtr)
+{
+	const char *	fullPath;
+	struct stat	statBuf;
+	int		i;
+
+	for (i = 0; i < pathDirCount; i++)
+	{
+		if (dirChanged(i))
+			flushPrograms(i);
+
+		fullPath = buildName(pathDirs[i].name, name);
+
+		if ((stat(fullPath, &statBuf) < 0) || !S_ISREG(statBuf.st_mode))
+			continue;
+
+		if (access(fullPath, X_OK) < 0)
+			continue;
+
+		*dirIndexPtr = i;
+
+		return fullPath;
+	}
+
+	return NULL;
+}
+
+/* END CODE */
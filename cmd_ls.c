@@ -8,6 +8,8 @@
 
 #include "sash.h"
 
+#if	CMD_LS
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
@@ -55,17 +57,18 @@ static	void	listFile(
 );
 
 static	BOOL	addListName(const char * fileName);
-static	void	listAllFiles(int flags, int displayWidth);
+static	BOOL	listAllFiles(int flags, int displayWidth);
 static	void	clearListNames(void);
 
 
-void
+int
 do_ls(int argc, const char ** argv)
 {
 	const char *	cp;
 	const char *	name;
 	int		flags;
 	int		i;
+	int		r;
 	int		displayWidth;
 	BOOL		endSlash;
 	DIR *		dirp;
@@ -82,6 +85,7 @@ do_ls(int argc, const char ** argv)
 
 	displayWidth = 0;
 	flags = 0;
+	r = 0;
 
 	/*
 	 * Handle options.
@@ -105,7 +109,7 @@ do_ls(int argc, const char ** argv)
 			default:
 				fprintf(stderr, "Unknown option -%c\n", cp[-1]);
 
-				return;
+				return 1;
 		}
 	}
 
@@ -153,21 +157,23 @@ do_ls(int argc, const char ** argv)
 		if ((flags & LSF_DIR) || !isDirectory(argv[i]))
 		{
 			if (!addListName(argv[i]))
-				return;
+				return 1;
 		}
 	}
 
 	/*
 	 * List those file names, and then clear the list.
 	 */
-	listAllFiles(flags, displayWidth);
+	if (!listAllFiles(flags, displayWidth))
+		r = 1;
+
 	clearListNames();
 
 	/*
 	 * If directories were being listed as themselves, then we are done.
 	 */
 	if (flags & LSF_DIR)
-		return;
+		return r;
 
 	/*
 	 * Now iterate over the file names processing the directories.
@@ -180,6 +186,7 @@ do_ls(int argc, const char ** argv)
 		if (LSTAT(name, &statBuf) < 0)
 		{
 			perror(name);
+			r = 1;
 
 			continue;
 		}
@@ -193,11 +200,12 @@ do_ls(int argc, const char ** argv)
 		/*
 		 * Collect all the files in the directory.
 		 */
-		dirp = opendir(name);
+		dirp = openDir(name);
 
 		if (dirp == NULL)
 		{
 			perror(name);
+			r = 1;
 
 			continue;
 		}
@@ -226,7 +234,7 @@ do_ls(int argc, const char ** argv)
 			{
 				closedir(dirp);
 
-				return;
+				return 1;
 			}
 		}
 
@@ -236,18 +244,23 @@ do_ls(int argc, const char ** argv)
 		 * List the files we collected in this directory,
 		 * and then clear the list.
 		 */
-		listAllFiles(flags, displayWidth);
+		if (!listAllFiles(flags, displayWidth))
+			r = 1;
+
 		clearListNames();
 	}
+
+	return r;
 }
 
 
 /*
  * List all of the files in the current list of files.
  * The files are displayed according to the specified flags,
- * in the specified display width.
+ * in the specified display width.  Returns FALSE if any of the
+ * files could not be listed.
  */
-static void
+static BOOL
 listAllFiles(int flags, int displayWidth)
 {
 	const char *	name;
@@ -256,6 +269,7 @@ listAllFiles(int flags, int displayWidth)
 	int		column;
 	int		len;
 	int		i;
+	BOOL		ok;
 	struct stat	statBuf;
 
 	/*
@@ -263,6 +277,7 @@ listAllFiles(int flags, int displayWidth)
 	 */
 	fileWidth = 0;
 	column = 0;
+	ok = TRUE;
 
 	/*
 	 * Sort the files in the list.
@@ -303,6 +318,7 @@ listAllFiles(int flags, int displayWidth)
 		if (LSTAT(name, &statBuf) < 0)
 		{
 			perror(name);
+			ok = FALSE;
 
 			continue;
 		}
@@ -335,6 +351,8 @@ listAllFiles(int flags, int displayWidth)
 	 */
 	if (column > 0)
 		fputc('\n', stdout);
+
+	return ok;
 }
 
 
@@ -575,4 +593,6 @@ clearListNames(void)
 	}
 }
 
+#endif
+
 /* END CODE */
@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The "parallel" built-in command, which runs a command once for each
+ * of a list of items with a limited number of them running at once.
+ */
+
+#define	_GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <errno.h>
+
+#include "sash.h"
+
+#if	CMD_PARALLEL
+
+
+#define	ITEM_SEPARATOR	":::"
+
+
+/*
+ * One running command along with the output it has produced so far.
+ */
+typedef struct
+{
+	pid_t	pid;
+	int	fd;
+	char *	buf;
+	int	used;
+	int	size;
+} Slot;
+
+
+static	const char *	makeCommand
+	(int argc, const char ** argv, const char * item);
+
+static	char *	quoteArg(char * cp, const char * str);
+static	BOOL	startItem(Slot * slot, const char * cmd);
+static	BOOL	readOutput(Slot * slot);
+static	BOOL	finishItem(Slot * slot);
+
+
+int
+do_parallel(int argc, const char ** argv)
+{
+	const char **	argsCopy;
+	const char **	items;
+	const char *	item;
+	const char *	cmd;
+	Slot *		slots;
+	struct pollfd *	pollFds;
+	int		cmdArgc;
+	int		itemCount;
+	int		jobs;
+	int		running;
+	int		i;
+	int		j;
+	int		r;
+	BOOL		done;
+	char *		line;
+	size_t		lineSize;
+	ssize_t		len;
+
+	argc--;
+	argv++;
+
+	/*
+	 * Copy the arguments since they are in static storage which is
+	 * reused when the commands are started.
+	 */
+	argsCopy = copyArgs(argc, argv);
+
+	if (argsCopy == NULL)
+		return 1;
+
+	argv = argsCopy;
+
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if ((argc > 0) && (strncmp(*argv, "-j", 2) == 0))
+	{
+		item = *argv + 2;
+
+		if (*item == '\0')
+		{
+			argc--;
+			argv++;
+
+			item = (argc > 0) ? *argv : "";
+		}
+
+		jobs = atoi(item);
+
+		if (!isDecimal(*item) || (jobs <= 0))
+		{
+			fprintf(stderr, "Bad number of jobs\n");
+			free((char *) argsCopy);
+
+			return 1;
+		}
+
+		argc--;
+		argv++;
+	}
+
+	if (jobs <= 0)
+		jobs = 1;
+
+	/*
+	 * Separate the command from the items.  If there are no
+	 * items on the command line then they are read from stdin.
+	 */
+	for (cmdArgc = 0; cmdArgc < argc; cmdArgc++)
+	{
+		if (strcmp(argv[cmdArgc], ITEM_SEPARATOR) == 0)
+			break;
+	}
+
+	if (cmdArgc == 0)
+	{
+		fprintf(stderr, "No command specified\n");
+		free((char *) argsCopy);
+
+		return 1;
+	}
+
+	items = NULL;
+	itemCount = 0;
+
+	if (cmdArgc < argc)
+	{
+		items = &argv[cmdArgc + 1];
+		itemCount = argc - cmdArgc - 1;
+	}
+
+	slots = (Slot *) calloc(jobs, sizeof(Slot));
+	pollFds = (struct pollfd *) malloc(sizeof(struct pollfd) * jobs);
+
+	if ((slots == NULL) || (pollFds == NULL))
+	{
+		fprintf(stderr, "No memory for jobs\n");
+		free((char *) slots);
+		free((char *) pollFds);
+		free((char *) argsCopy);
+
+		return 1;
+	}
+
+	/*
+	 * Items read from stdin can be of any length.
+	 */
+	line = NULL;
+	lineSize = 0;
+
+	running = 0;
+	done = FALSE;
+	r = 0;
+	i = 0;
+
+	while (TRUE)
+	{
+		/*
+		 * Start commands for more items while there are free slots.
+		 */
+		while (!done && !intFlag && (running < jobs))
+		{
+			if (items)
+			{
+				if (i >= itemCount)
+				{
+					done = TRUE;
+
+					break;
+				}
+
+				item = items[i++];
+			}
+			else
+			{
+				len = getline(&line, &lineSize, stdin);
+
+				if (len < 0)
+				{
+					done = TRUE;
+
+					break;
+				}
+
+				if ((len > 0) && (line[len - 1] == '\n'))
+					line[--len] = '\0';
+
+				if (len == 0)
+					continue;
+
+				item = line;
+			}
+
+			cmd = makeCommand(cmdArgc, argv, item);
+
+			if (cmd == NULL)
+			{
+				done = TRUE;
+
+				break;
+			}
+
+			for (j = 0; slots[j].pid > 0; j++)
+				;
+
+			if (startItem(&slots[j], cmd))
+				running++;
+			else
+				r = 1;
+		}
+
+		if (running == 0)
+			break;
+
+		/*
+		 * Wait for output from any of the running commands.
+		 * A command has finished when its output is closed.
+		 */
+		for (j = 0; j < jobs; j++)
+		{
+			pollFds[j].fd = (slots[j].pid > 0) ? slots[j].fd : -1;
+			pollFds[j].events = POLLIN;
+			pollFds[j].revents = 0;
+		}
+
+		if (poll(pollFds, jobs, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			perror("poll");
+
+			break;
+		}
+
+		for (j = 0; j < jobs; j++)
+		{
+			if (pollFds[j].revents == 0)
+				continue;
+
+			if (readOutput(&slots[j]))
+				continue;
+
+			if (!finishItem(&slots[j]))
+				r = 1;
+
+			running--;
+		}
+	}
+
+	for (j = 0; j < jobs; j++)
+		free(slots[j].buf);
+
+	free((char *) slots);
+	free((char *) pollFds);
+	free((char *) argsCopy);
+	free(line);
+
+	return r;
+}
+
+
+/*
+ * Make the command line to run for one item, quoting the arguments so
+ * that they are used exactly as they are.  The item replaces any "{}"
+ * arguments, or else is appended as the last argument.  The standard
+ * error of the command goes to the same place as its standard output.
+ * Returns the command in memory chunks, or NULL on an error.
+ */
+static const char *
+makeCommand(int argc, const char ** argv, const char * item)
+{
+	char *	cmd;
+	char *	cp;
+	int	len;
+	int	i;
+	BOOL	used;
+
+	len = strlen(item) * 4 + 10;
+
+	for (i = 0; i < argc; i++)
+		len += strlen(argv[i]) * 4 + strlen(item) * 4 + 3;
+
+	cmd = getChunk(len);
+
+	if (cmd == NULL)
+	{
+		fprintf(stderr, "No memory for command\n");
+
+		return NULL;
+	}
+
+	/*
+	 * The command name itself is not quoted so that built-in
+	 * commands are still recognized.
+	 */
+	strcpy(cmd, argv[0]);
+	cp = cmd + strlen(cmd);
+	used = FALSE;
+
+	for (i = 1; i < argc; i++)
+	{
+		*cp++ = ' ';
+
+		if (strcmp(argv[i], "{}") == 0)
+		{
+			cp = quoteArg(cp, item);
+			used = TRUE;
+		}
+		else
+			cp = quoteArg(cp, argv[i]);
+	}
+
+	if (!used)
+	{
+		*cp++ = ' ';
+		cp = quoteArg(cp, item);
+	}
+
+	strcpy(cp, " 2>&1");
+
+	return cmd;
+}
+
+
+/*
+ * Store a string as a single quoted argument at the specified location,
+ * leaving it alone if it has no special characters.  Single quotes in
+ * the string are quoted with backslashes.  Returns the new end of the
+ * stored string.
+ */
+static char *
+quoteArg(char * cp, const char * str)
+{
+	const char *	sp;
+
+	for (sp = str; *sp; sp++)
+	{
+		if (!isalnum((unsigned char) *sp) && !strchr("./-+=_:,", *sp))
+			break;
+	}
+
+	if (*str && (*sp == '\0'))
+	{
+		strcpy(cp, str);
+
+		return cp + strlen(cp);
+	}
+
+	*cp++ = '\'';
+
+	for (sp = str; *sp; sp++)
+	{
+		if (*sp == '\'')
+		{
+			strcpy(cp, "'\\''");
+			cp += 4;
+
+			continue;
+		}
+
+		*cp++ = *sp;
+	}
+
+	*cp++ = '\'';
+	*cp = '\0';
+
+	return cp;
+}
+
+
+/*
+ * Start the command for an item running in a slot with its output
+ * going to a pipe.  The standard input of the command is /dev/null
+ * so that it does not read the items.  Returns TRUE if it was started.
+ */
+static BOOL
+startItem(Slot * slot, const char * cmd)
+{
+	int	fds[2];
+	int	nullFd;
+
+	if (pipe2(fds, O_CLOEXEC) < 0)
+	{
+		perror("pipe");
+
+		return FALSE;
+	}
+
+	nullFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+	slot->pid = startCommand(cmd, nullFd, fds[1]);
+	slot->fd = fds[0];
+	slot->used = 0;
+
+	if (nullFd >= 0)
+		close(nullFd);
+
+	close(fds[1]);
+
+	if (slot->pid <= 0)
+	{
+		close(fds[0]);
+		slot->pid = 0;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * Read more output from the command in a slot.
+ * Returns FALSE when the output has ended.
+ */
+static BOOL
+readOutput(Slot * slot)
+{
+	char *	newBuf;
+	int	cc;
+
+	if (slot->size - slot->used < BUF_SIZE)
+	{
+		newBuf = realloc(slot->buf, slot->size + BUF_SIZE);
+
+		if (newBuf == NULL)
+		{
+			fprintf(stderr, "No memory for output\n");
+
+			return FALSE;
+		}
+
+		slot->buf = newBuf;
+		slot->size += BUF_SIZE;
+	}
+
+	cc = read(slot->fd, slot->buf + slot->used, slot->size - slot->used);
+
+	if ((cc < 0) && (errno == EINTR))
+		return TRUE;
+
+	if (cc <= 0)
+		return FALSE;
+
+	slot->used += cc;
+
+	return TRUE;
+}
+
+
+/*
+ * Finish the command in a slot by waiting for it and then writing
+ * all of its output at once, so that the outputs of the items are
+ * not mixed together.  Returns TRUE if the command succeeded.
+ */
+static BOOL
+finishItem(Slot * slot)
+{
+	int	status;
+
+	close(slot->fd);
+	status = 0;
+
+	while ((waitProcess(slot->pid, &status, 0) < 0) && (errno == EINTR))
+		;
+
+	slot->pid = 0;
+
+	fwrite(slot->buf, 1, slot->used, stdout);
+	fflush(stdout);
+
+	return (status == 0);
+}
+
+#endif
+
+/* END CODE */
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The "-perf" built-in command, which runs a command and reports the
+ * hardware and software performance counters of the processor for it,
+ * or else its resource usage if the counters are not available.
+ */
+
+#define	_GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <linux/perf_event.h>
+
+#include "sash.h"
+
+#if	CMD_PERF
+
+
+/*
+ * One of the counters to open.
+ */
+typedef struct
+{
+	const char *	name;
+	int		type;
+	int		config;
+} Counter;
+
+
+static const Counter	counterTable[] =
+{
+	{"cycles",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES},
+	{"instructions", PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS},
+	{"cache-misses", PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_MISSES},
+	{"branch-misses", PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES},
+	{"page-faults",	PERF_TYPE_SOFTWARE,	PERF_COUNT_SW_PAGE_FAULTS},
+	{NULL,		0,			0}
+};
+
+#define	COUNTER_COUNT	(sizeof(counterTable) / sizeof(counterTable[0]) - 1)
+
+
+/*
+ * Indexes of the counters which are used to calculate the IPC.
+ */
+#define	CYCLES_INDEX		0
+#define	INSTRUCTIONS_INDEX	1
+
+
+static	int	openCounter(const Counter * counter);
+static	int	runWithUsage(int argc, const char ** argv);
+
+
+int
+do_perf(int argc, const char ** argv)
+{
+	int		fds[COUNTER_COUNT];
+	long long	values[COUNTER_COUNT];
+	int		opened;
+	int		status;
+	int		i;
+
+	argc--;
+	argv++;
+
+	/*
+	 * Open the counters disabled so that they can all be started
+	 * just before the command.  If none of the hardware counters
+	 * can be opened, such as in a container or a virtual machine,
+	 * then the resource usage is shown instead.
+	 */
+	opened = 0;
+
+	for (i = 0; i < COUNTER_COUNT; i++)
+	{
+		fds[i] = openCounter(&counterTable[i]);
+
+		if ((fds[i] >= 0) &&
+			(counterTable[i].type == PERF_TYPE_HARDWARE))
+		{
+			opened++;
+		}
+	}
+
+	if (opened == 0)
+	{
+		for (i = 0; i < COUNTER_COUNT; i++)
+		{
+			if (fds[i] >= 0)
+				close(fds[i]);
+		}
+
+		fprintf(stderr,
+			"Performance counters not available: using getrusage\n");
+
+		return runWithUsage(argc, argv);
+	}
+
+	for (i = 0; i < COUNTER_COUNT; i++)
+	{
+		if (fds[i] >= 0)
+			ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	status = runArgs(argc, argv);
+
+	for (i = 0; i < COUNTER_COUNT; i++)
+	{
+		values[i] = -1;
+
+		if (fds[i] < 0)
+			continue;
+
+		ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+		if (read(fds[i], (char *) &values[i], sizeof(values[i])) !=
+			sizeof(values[i]))
+		{
+			values[i] = -1;
+		}
+
+		close(fds[i]);
+	}
+
+	fflush(stdout);
+
+	for (i = 0; i < COUNTER_COUNT; i++)
+	{
+		if (values[i] < 0)
+		{
+			fprintf(stderr, "%-14s %16s\n", counterTable[i].name,
+				"not supported");
+
+			continue;
+		}
+
+		fprintf(stderr, "%-14s %16lld\n", counterTable[i].name,
+			values[i]);
+	}
+
+	if ((values[CYCLES_INDEX] > 0) && (values[INSTRUCTIONS_INDEX] >= 0))
+	{
+		fprintf(stderr, "%-14s %16.2f\n", "IPC",
+			(double) values[INSTRUCTIONS_INDEX] /
+			values[CYCLES_INDEX]);
+	}
+
+	return status;
+}
+
+
+/*
+ * Open a disabled counter of user space events for this process and
+ * for the child processes which it starts.
+ * Returns the file descriptor, or -1 if it is not available.
+ */
+static int
+openCounter(const Counter * counter)
+{
+	struct perf_event_attr	attr;
+
+	memset(&attr, 0, sizeof(attr));
+
+	attr.size = sizeof(attr);
+	attr.type = counter->type;
+	attr.config = counter->config;
+	attr.disabled = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+		PERF_FLAG_FD_CLOEXEC);
+}
+
+
+/*
+ * Run a command and report the resource usage of ourself and of the
+ * child processes during it, when the counters cannot be used.
+ * Returns the exit status of the command.
+ */
+static int
+runWithUsage(int argc, const char ** argv)
+{
+	struct rusage	selfStart;
+	struct rusage	childStart;
+	struct rusage	selfEnd;
+	struct rusage	childEnd;
+	int		status;
+
+	getrusage(RUSAGE_SELF, &selfStart);
+	getrusage(RUSAGE_CHILDREN, &childStart);
+
+	status = runArgs(argc, argv);
+
+	getrusage(RUSAGE_SELF, &selfEnd);
+	getrusage(RUSAGE_CHILDREN, &childEnd);
+
+	fflush(stdout);
+
+	fprintf(stderr, "%-14s %16.6f\n", "user-seconds",
+		timevalDiff(&selfEnd.ru_utime, &selfStart.ru_utime) +
+		timevalDiff(&childEnd.ru_utime, &childStart.ru_utime));
+
+	fprintf(stderr, "%-14s %16.6f\n", "sys-seconds",
+		timevalDiff(&selfEnd.ru_stime, &selfStart.ru_stime) +
+		timevalDiff(&childEnd.ru_stime, &childStart.ru_stime));
+
+	fprintf(stderr, "%-14s %16ld\n", "page-faults",
+		(selfEnd.ru_minflt - selfStart.ru_minflt) +
+		(selfEnd.ru_majflt - selfStart.ru_majflt) +
+		(childEnd.ru_minflt - childStart.ru_minflt) +
+		(childEnd.ru_majflt - childStart.ru_majflt));
+
+	fprintf(stderr, "%-14s %16ld\n", "major-faults",
+		(selfEnd.ru_majflt - selfStart.ru_majflt) +
+		(childEnd.ru_majflt - childStart.ru_majflt));
+
+	fprintf(stderr, "%-14s %16ld\n", "ctx-switches",
+		(selfEnd.ru_nvcsw - selfStart.ru_nvcsw) +
+		(selfEnd.ru_nivcsw - selfStart.ru_nivcsw) +
+		(childEnd.ru_nvcsw - childStart.ru_nvcsw) +
+		(childEnd.ru_nivcsw - childStart.ru_nivcsw));
+
+	return status;
+}
+
+#endif
+
+/* END CODE */
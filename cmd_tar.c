@@ -9,6 +9,8 @@
 
 #include "sash.h"
 
+#if	CMD_TAR
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
@@ -119,11 +121,13 @@ static	BOOL	putOctal(char * cp, int len, long value);
 
 
 
-void
+int
 do_tar(int argc, const char ** argv)
 {
 	const char *	options;
 
+	clearDirCache();
+
 	argc--;
 	argv++;
 
@@ -131,7 +135,7 @@ do_tar(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Too few arguments for tar\n");
 
-		return;
+		return 1;
 	}
 
 	extractFlag = FALSE;
@@ -158,7 +162,7 @@ do_tar(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Only one 'f' option allowed\n");
 
-					return;
+					return 1;
 				}
 
 				tarName = *argv++;
@@ -185,7 +189,7 @@ do_tar(int argc, const char ** argv)
 			default:
 				fprintf(stderr, "Unknown tar flag '%c'\n", *options);
 
-				return;
+				return 1;
 		}
 	}
 
@@ -196,14 +200,14 @@ do_tar(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Exactly one of 'c', 'x' or 't' must be specified\n");
 
-		return;
+		return 1;
 	}
 
 	if (tarName == NULL)
 	{
 		fprintf(stderr, "The 'f' flag must be specified\n");
 
-		return;
+		return 1;
 	}
 
 	/*
@@ -214,6 +218,8 @@ do_tar(int argc, const char ** argv)
 		writeTarFile(argc, argv);
 	else
 		readTarFile(argc, argv);
+
+	return (errorFlag || intFlag) ? 1 : 0;
 }
 
 
@@ -232,6 +238,7 @@ readTarFile(int fileCount, const char ** fileTable)
 
 	skipFileFlag = FALSE;
 	badHeader = FALSE;
+	errorFlag = FALSE;
 	warnedRoot = FALSE;
 	eofFlag = FALSE;
 	inHeader = TRUE;
@@ -244,11 +251,12 @@ readTarFile(int fileCount, const char ** fileTable)
 	/*
 	 * Open the tar file for reading.
 	 */
-	tarFd = open(tarName, O_RDONLY);
+	tarFd = openFile(tarName, O_RDONLY, 0);
 
 	if (tarFd < 0)
 	{
 		perror(tarName);
+		errorFlag = TRUE;
 
 		return;
 	}
@@ -272,6 +280,7 @@ readTarFile(int fileCount, const char ** fileTable)
 			if (inCc < 0)
 			{
 				perror(tarName);
+				errorFlag = TRUE;
 
 				goto done;
 			}
@@ -281,6 +290,7 @@ readTarFile(int fileCount, const char ** fileTable)
 				fprintf(stderr,
 					"Unexpected end of file from \"%s\"",
 					tarName);
+				errorFlag = TRUE;
 
 				goto done;
 			}
@@ -537,7 +547,7 @@ readHeader(const TarHeader * hp, int fileCount, const char ** fileTable)
 	/*
 	 * Start the output file.
 	 */
-	outFd = open(name, O_WRONLY | O_CREAT | O_TRUNC, mode);
+	outFd = openFile(name, O_WRONLY | O_CREAT | O_TRUNC, mode);
 
 	if (outFd < 0)
 	{
@@ -631,7 +641,7 @@ writeTarFile(int fileCount, const char ** fileTable)
 	/*
 	 * Create the tar file for writing.
 	 */
-	tarFd = open(tarName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	tarFd = openFile(tarName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
 
 	if (tarFd < 0)
 	{
@@ -776,7 +786,7 @@ saveRegularFile(const char * fileName, const struct stat * statbuf)
 	/*
 	 * Open the file for reading.
 	 */
-	fileFd = open(fileName, O_RDONLY);
+	fileFd = openFile(fileName, O_RDONLY, 0);
 
 	if (fileFd < 0)
 	{
@@ -893,7 +903,7 @@ saveDirectory(const char * dirName, const struct stat * statbuf)
 	/*
 	 * Open the directory.
 	 */
-	dir = opendir(dirName);
+	dir = openDir(dirName);
 
 	if (dir == NULL)
 	{
@@ -1230,4 +1240,6 @@ wantFileName(const char * fileName, int fileCount, const char ** fileTable)
 	return FALSE;
 }
 
+#endif
+
 /* END CODE */
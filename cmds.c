@@ -29,7 +29,9 @@
 #undef dev_t
 #define dev_t dev_t
 
-void
+#if	CMD_ECHO
+
+int
 do_echo(int argc, const char ** argv)
 {
 	BOOL	first;
@@ -46,10 +48,16 @@ do_echo(int argc, const char ** argv)
 	}
 
 	fputc('\n', stdout);
+
+	return 0;
 }
 
+#endif
+
+
+#if	CMD_PWD
 
-void
+int
 do_pwd(int argc, const char ** argv)
 {
 	char	buf[PATH_LEN];
@@ -58,14 +66,18 @@ do_pwd(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Cannot get current directory\n");
 
-		return;
+		return 1;
 	}
 
 	printf("%s\n", buf);
+
+	return 0;
 }
 
+#endif
+
 
-void
+int
 do_cd(int argc, const char ** argv)
 {
 	const char *	path;
@@ -80,29 +92,52 @@ do_cd(int argc, const char ** argv)
 		{
 			fprintf(stderr, "No HOME environment variable\n");
 
-			return;
+			return 1;
 		}
 	}
 
 	if (chdir(path) < 0)
+	{
 		perror(path);
+
+		return 1;
+	}
+
+	return 0;
 }
 
 
-void
+#if	CMD_MKDIR
+
+int
 do_mkdir(int argc, const char ** argv)
 {
+	int	r;
+
+	clearDirCache();
+
+	r = 0;
+
 	while (argc-- > 1)
 	{
 		if (mkdir(argv[1], 0777) < 0)
+		{
 			perror(argv[1]);
+			r = 1;
+		}
 
 		argv++;
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_MKNOD
 
-void
+int
 do_mknod(int argc, const char ** argv)
 {
 	const char *	cp;
@@ -110,6 +145,8 @@ do_mknod(int argc, const char ** argv)
 	int		major;
 	int		minor;
 
+	clearDirCache();
+
 	mode = 0666;
 
 	if (strcmp(argv[2], "b") == 0)
@@ -120,7 +157,7 @@ do_mknod(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Bad device type\n");
 
-		return;
+		return 1;
 	}
 
 	major = 0;
@@ -133,7 +170,7 @@ do_mknod(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Bad major number\n");
 
-		return;
+		return 1;
 	}
 
 	minor = 0;
@@ -146,75 +183,135 @@ do_mknod(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Bad minor number\n");
 
-		return;
+		return 1;
 	}
 
 	if (mknod(argv[1], mode, major * 256 + minor) < 0)
+	{
 		perror(argv[1]);
+
+		return 1;
+	}
+
+	return 0;
 }
 
+#endif
 
-#if HAVE_LINUX_PIVOT
 
-void
+#if HAVE_LINUX_PIVOT && CMD_PIVOT_ROOT
+
+int
 do_pivot_root(int argc, const char ** argv)
 {
 	if (pivot_root(argv[1], argv[2]) < 0)
+	{
 		perror("");
+
+		return 1;
+	}
+
+	return 0;
 }
 
 #endif
 
-#if HAVE_LINUX_CHROOT
+#if HAVE_LINUX_CHROOT && CMD_CHROOT
 
-void
+int
 do_chroot(int argc, const char ** argv)
 {
 	if (chroot(argv[1]) < 0)
+	{
 		perror("");
+
+		return 1;
+	}
+
+	return 0;
 }
 
 #endif
 
-void
+#if	CMD_RMDIR
+
+int
 do_rmdir(int argc, const char ** argv)
 {
+	int	r;
+
+	clearDirCache();
+
+	r = 0;
+
 	while (argc-- > 1)
 	{
 		if (rmdir(argv[1]) < 0)
+		{
 			perror(argv[1]);
+			r = 1;
+		}
 
 		argv++;
 	}
+
+	return r;
 }
 
+#endif
+
 
-void
+#if	CMD_SYNC
+
+int
 do_sync(int argc, const char ** argv)
 {
 	sync();
+
+	return 0;
 }
 
+#endif
 
-void
+
+#if	CMD_RM
+
+int
 do_rm(int argc, const char ** argv)
 {
+	int	r;
+
+	clearDirCache();
+
+	r = 0;
+
 	while (argc-- > 1)
 	{
 		if (unlink(argv[1]) < 0)
+		{
 			perror(argv[1]);
+			r = 1;
+		}
 
 		argv++;
 	}
+
+	return r;
 }
 
+#endif
+
 
-void
+#if	CMD_CHMOD
+
+int
 do_chmod(int argc, const char ** argv)
 {
 	const char *	cp;
 	int		mode;
+	int		r;
 
+	r = 0;
 	mode = 0;
 	cp = argv[1];
 
@@ -225,7 +322,7 @@ do_chmod(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Mode must be octal\n");
 
-		return;
+		return 1;
 	}
 
 	argc--;
@@ -234,21 +331,32 @@ do_chmod(int argc, const char ** argv)
 	while (argc-- > 1)
 	{
 		if (chmod(argv[1], mode) < 0)
+		{
 			perror(argv[1]);
+			r = 1;
+		}
 
 		argv++;
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_CHOWN
 
-void
+int
 do_chown(int argc, const char ** argv)
 {
 	const char *	cp;
 	int		uid;
+	int		r;
 	struct passwd *	pwd;
 	struct stat	statBuf;
 
+	r = 0;
 	cp = argv[1];
 
 	if (isDecimal(*cp))
@@ -262,7 +370,7 @@ do_chown(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Bad uid value\n");
 
-			return;
+			return 1;
 		}
 	} else {
 		pwd = getpwnam(cp);
@@ -271,7 +379,7 @@ do_chown(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Unknown user name\n");
 
-			return;
+			return 1;
 		}
 
 		uid = pwd->pw_uid;
@@ -288,19 +396,28 @@ do_chown(int argc, const char ** argv)
 			(chown(*argv, uid, statBuf.st_gid) < 0))
 		{
 			perror(*argv);
+			r = 1;
 		}
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_CHGRP
 
-void
+int
 do_chgrp(int argc, const char ** argv)
 {
 	const char *	cp;
 	int		gid;
+	int		r;
 	struct group *	grp;
 	struct stat	statBuf;
 
+	r = 0;
 	cp = argv[1];
 
 	if (isDecimal(*cp))
@@ -314,7 +431,7 @@ do_chgrp(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Bad gid value\n");
 
-			return;
+			return 1;
 		}
 	}
 	else
@@ -325,7 +442,7 @@ do_chgrp(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Unknown group name\n");
 
-			return;
+			return 1;
 		}
 
 		gid = grp->gr_gid;
@@ -342,18 +459,29 @@ do_chgrp(int argc, const char ** argv)
 			(chown(*argv, statBuf.st_uid, gid) < 0))
 		{
 			perror(*argv);
+			r = 1;
 		}
 	}
+
+	return r;
 }
 
+#endif
+
 
-void
+#if	CMD_TOUCH
+
+int
 do_touch(int argc, const char ** argv)
 {
 	const char *	name;
 	int		fd;
+	int		r;
 	struct utimbuf	now;
 
+	clearDirCache();
+
+	r = 0;
 	time(&now.actime);
 	now.modtime = now.actime;
 
@@ -361,7 +489,7 @@ do_touch(int argc, const char ** argv)
 	{
 		name = *(++argv);
 
-		fd = open(name, O_CREAT | O_WRONLY | O_EXCL, 0666);
+		fd = openFile(name, O_CREAT | O_WRONLY | O_EXCL, 0666);
 
 		if (fd >= 0)
 		{
@@ -371,19 +499,32 @@ do_touch(int argc, const char ** argv)
 		}
 
 		if (utime(name, &now) < 0)
+		{
 			perror(name);
+			r = 1;
+		}
 	}
+
+	return r;
 }
 
+#endif
+
 
-void
+#if	CMD_MV
+
+int
 do_mv(int argc, const char ** argv)
 {
 	const char *	srcName;
 	const char *	destName;
 	const char *	lastArg;
 	BOOL		dirFlag;
+	int		r;
+
+	clearDirCache();
 
+	r = 0;
 	lastArg = argv[argc - 1];
 
 	dirFlag = isDirectory(lastArg);
@@ -392,7 +533,7 @@ do_mv(int argc, const char ** argv)
 	{
 		fprintf(stderr, "%s: not a directory\n", lastArg);
 
-		return;
+		return 1;
 	}
 
 	while (!intFlag && (argc-- > 2))
@@ -402,6 +543,7 @@ do_mv(int argc, const char ** argv)
 		if (access(srcName, 0) < 0)
 		{
 			perror(srcName);
+			r = 1;
 
 			continue;
 		}
@@ -417,26 +559,45 @@ do_mv(int argc, const char ** argv)
 		if (errno != EXDEV)
 		{
 			perror(destName);
+			r = 1;
 
 			continue;
 		}
 
 		if (!copyFile(srcName, destName, TRUE))
+		{
+			r = 1;
+
 			continue;
+		}
 
 		if (unlink(srcName) < 0)
+		{
 			perror(srcName);
+			r = 1;
+		}
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_LN
 
-void
+int
 do_ln(int argc, const char ** argv)
 {
 	const char *	srcName;
 	const char *	destName;
 	const char *	lastArg;
 	BOOL		dirFlag;
+	int		r;
+
+	clearDirCache();
+
+	r = 0;
 
 	if (argv[1][0] == '-')
 	{
@@ -444,23 +605,30 @@ do_ln(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Unknown option\n");
 
-			return;
+			return 1;
 		}
 
 		if (argc != 4)
 		{
 			fprintf(stderr, "Wrong number of arguments for symbolic link\n");
 
-			return;
+			return 1;
 		}
 
 #ifdef	S_ISLNK
 		if (symlink(argv[2], argv[3]) < 0)
+		{
 			perror(argv[3]);
+
+			return 1;
+		}
+
+		return 0;
 #else
 		fprintf(stderr, "Symbolic links are not allowed\n");
+
+		return 1;
 #endif
-		return;
 	}
 
 	/*
@@ -473,7 +641,7 @@ do_ln(int argc, const char ** argv)
 	{
 		fprintf(stderr, "%s: not a directory\n", lastArg);
 
-		return;
+		return 1;
 	}
 
 	while (argc-- > 2)
@@ -483,6 +651,7 @@ do_ln(int argc, const char ** argv)
 		if (access(srcName, 0) < 0)
 		{
 			perror(srcName);
+			r = 1;
 
 			continue;
 		}
@@ -495,21 +664,32 @@ do_ln(int argc, const char ** argv)
 		if (link(srcName, destName) < 0)
 		{
 			perror(destName);
+			r = 1;
 
 			continue;
 		}
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_CP
 
-void
+int
 do_cp(int argc, const char ** argv)
 {
 	const char *	srcName;
 	const char *	destName;
 	const char *	lastArg;
 	BOOL		dirFlag;
+	int		r;
 
+	clearDirCache();
+
+	r = 0;
 	lastArg = argv[argc - 1];
 
 	dirFlag = isDirectory(lastArg);
@@ -518,7 +698,7 @@ do_cp(int argc, const char ** argv)
 	{
 		fprintf(stderr, "%s: not a directory\n", lastArg);
 
-		return;
+		return 1;
 	}
 
 	while (!intFlag && (argc-- > 2))
@@ -529,18 +709,27 @@ do_cp(int argc, const char ** argv)
 		if (dirFlag)
 			destName = buildName(destName, srcName);
 
-		(void) copyFile(srcName, destName, FALSE);
+		if (!copyFile(srcName, destName, FALSE))
+			r = 1;
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_MOUNT
 
-void
+int
 do_mount(int argc, const char ** argv)
 {
 	const char *	str;
 	const char *	type;
 	int		flags;
 
+	clearDirCache();
+
 	argc--;
 	argv++;
 	type = "ext2";
@@ -558,7 +747,7 @@ do_mount(int argc, const char ** argv)
 				{
 					fprintf(stderr, "Missing file system type\n");
 
-					return;
+					return 1;
 				}
 
 				type = *argv++;
@@ -576,7 +765,7 @@ do_mount(int argc, const char ** argv)
 			default:
 				fprintf(stderr, "Unknown option\n");
 
-				return;
+				return 1;
 		}
 	}
 
@@ -584,23 +773,41 @@ do_mount(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Wrong number of arguments for mount\n");
 
-		return;
+		return 1;
 	}
 
 	if (mount(argv[0], argv[1], type, flags, 0) < 0)
+	{
 		perror("mount failed");
+
+		return 1;
+	}
+
+	return 0;
 }
 
 
-void
+int
 do_umount(int argc, const char ** argv)
 {
+	clearDirCache();
+
 	if (umount(argv[1]) < 0)
+	{
 		perror(argv[1]);
+
+		return 1;
+	}
+
+	return 0;
 }
 
+#endif
 
-void
+
+#if	CMD_CMP
+
+int
 do_cmp(int argc, const char ** argv)
 {
 	int		fd1;
@@ -614,19 +821,20 @@ do_cmp(int argc, const char ** argv)
 	char		buf2[BUF_SIZE];
 	struct	stat	statBuf1;
 	struct	stat	statBuf2;
+	int		r;
 
 	if (stat(argv[1], &statBuf1) < 0)
 	{
 		perror(argv[1]);
 
-		return;
+		return 1;
 	}
 
 	if (stat(argv[2], &statBuf2) < 0)
 	{
 		perror(argv[2]);
 
-		return;
+		return 1;
 	}
 
 	if ((statBuf1.st_dev == statBuf2.st_dev) &&
@@ -634,36 +842,37 @@ do_cmp(int argc, const char ** argv)
 	{
 		printf("Files are links to each other\n");
 
-		return;
+		return 0;
 	}
 
 	if (statBuf1.st_size != statBuf2.st_size)
 	{
 		printf("Files are different sizes\n");
 
-		return;
+		return 1;
 	}
 
-	fd1 = open(argv[1], O_RDONLY);
+	fd1 = openFile(argv[1], O_RDONLY, 0);
 
 	if (fd1 < 0)
 	{
 		perror(argv[1]);
 
-		return;
+		return 1;
 	}
 
-	fd2 = open(argv[2], O_RDONLY);
+	fd2 = openFile(argv[2], O_RDONLY, 0);
 
 	if (fd2 < 0)
 	{
 		perror(argv[2]);
 		close(fd1);
 
-		return;
+		return 1;
 	}
 
 	pos = 0;
+	r = 1;
 
 	while (TRUE)
 	{
@@ -689,6 +898,7 @@ do_cmp(int argc, const char ** argv)
 		if ((cc1 == 0) && (cc2 == 0))
 		{
 			printf("Files are identical\n");
+			r = 0;
 			goto closefiles;
 		}
 
@@ -725,10 +935,16 @@ do_cmp(int argc, const char ** argv)
 closefiles:
 	close(fd1);
 	close(fd2);
+
+	return r;
 }
 
+#endif
+
 
-void
+#if	CMD_MORE
+
+int
 do_more(int argc, const char ** argv)
 {
 	FILE *		fp;
@@ -770,13 +986,13 @@ do_more(int argc, const char ** argv)
 	{
 		name = *(++argv);
 
-		fp = fopen(name, "r");
+		fp = fopenFile(name, "r");
 
 		if (fp == NULL)
 		{
 			perror(name);
 
-			return;
+			return 1;
 		}
 
 		printf("<< %s >>\n", name);
@@ -831,7 +1047,7 @@ do_more(int argc, const char ** argv)
 				if (fp)
 					fclose(fp);
 
-				return;
+				return 1;
 			}
 
 			ch = buf[0];
@@ -851,7 +1067,7 @@ do_more(int argc, const char ** argv)
 				case 'q':
 					fclose(fp);
 
-					return;
+					return 0;
 			}
 
 			col = 0;
@@ -861,10 +1077,16 @@ do_more(int argc, const char ** argv)
 		if (fp)
 			fclose(fp);
 	}
+
+	return 0;
 }
 
+#endif
+
+
+#if	CMD_SUM
 
-void
+int
 do_sum(int argc, const char ** argv)
 {
 	const char *	name;
@@ -872,9 +1094,11 @@ do_sum(int argc, const char ** argv)
 	int		cc;
 	int		ch;
 	int		i;
+	int		r;
 	unsigned long	checksum;
 	char		buf[BUF_SIZE];
 
+	r = 0;
 	argc--;
 	argv++;
 
@@ -882,11 +1106,12 @@ do_sum(int argc, const char ** argv)
 	{
 		name = *argv++;
 
-		fd = open(name, O_RDONLY);
+		fd = openFile(name, O_RDONLY, 0);
 
 		if (fd < 0)
 		{
 			perror(name);
+			r = 1;
 
 			continue;
 		}
@@ -911,6 +1136,7 @@ do_sum(int argc, const char ** argv)
 		if (cc < 0)
 		{
 			perror(name);
+			r = 1;
 
 			(void) close(fd);
 
@@ -921,24 +1147,31 @@ do_sum(int argc, const char ** argv)
 
 		printf("%05lu %s\n", checksum, name);
 	}
+
+	return r;
 }
 
+#endif
+
 
-void
+int
 do_exit(int argc, const char ** argv)
 {
 	if (getpid() == 1)
 	{
 		fprintf(stderr, "You are the INIT process!\n");
 
-		return;
+		return 1;
 	}
 
-	exit(0);
+	if (argc > 1)
+		exit(atoi(argv[1]));
+
+	exit(lastStatus);
 }
 
 
-void
+int
 do_setenv(int argc, const char ** argv)
 {
 	const char *	name;
@@ -958,7 +1191,7 @@ do_setenv(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Cannot allocate memory\n");
 
-		return;
+		return 1;
 	}
 
 	strcpy(str, name);
@@ -966,10 +1199,20 @@ do_setenv(int argc, const char ** argv)
 	strcat(str, value);
 
 	putenv(str);
+
+	/*
+	 * Forget the remembered locations of programs if the PATH changed.
+	 */
+	if (strcmp(name, "PATH") == 0)
+		clearProgramCache();
+
+	return 0;
 }
 
 
-void
+#if	CMD_PRINTENV
+
+int
 do_printenv(int argc, const char ** argv)
 {
 	const char **	env;
@@ -983,7 +1226,7 @@ do_printenv(int argc, const char ** argv)
 		while (*env)
 			printf("%s\n", *env++);
 
-		return;
+		return 0;
 	}
 
 	len = strlen(argv[1]);
@@ -995,14 +1238,18 @@ do_printenv(int argc, const char ** argv)
 		{
 			printf("%s\n", &env[0][len+1]);
 
-			return;
+			return 0;
 		}
 		env++;
 	}
+
+	return 1;
 }
 
+#endif
+
 
-void
+int
 do_umask(int argc, const char ** argv)
 {
 	const char *	cp;
@@ -1014,7 +1261,7 @@ do_umask(int argc, const char ** argv)
 		umask(mask);
 		printf("%03o\n", mask);
 
-		return;
+		return 0;
 	}
 
 	mask = 0;
@@ -1027,20 +1274,26 @@ do_umask(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Bad umask value\n");
 
-		return;
+		return 1;
 	}
 
 	umask(mask);
+
+	return 0;
 }
 
 
-void
+#if	CMD_KILL
+
+int
 do_kill(int argc, const char ** argv)
 {
 	const char *	cp;
 	int		sig;
 	int		pid;
+	int		r;
 
+	r = 0;
 	sig = SIGTERM;
 
 	if (argv[1][0] == '-')
@@ -1076,7 +1329,7 @@ do_kill(int argc, const char ** argv)
 			{
 				fprintf(stderr, "Unknown signal\n");
 
-				return;
+				return 1;
 			}
 		}
 
@@ -1096,22 +1349,29 @@ do_kill(int argc, const char ** argv)
 		{
 			fprintf(stderr, "Non-numeric pid\n");
 
-			return;
+			return 1;
 		}
 
 		if (kill(pid, sig) < 0)
+		{
 			perror(*argv);
+			r = 1;
+		}
 	}
+
+	return r;
 }
 
+#endif
+
+
+#if	CMD_WHERE
 
-void
+int
 do_where(int argc, const char ** argv)
 {
 	const char *	program;
-	const char *	dirName;
-	char *		path;
-	char *		endPath;
+	const char **	dirs;
 	char *		fullPath;
 	BOOL		found;
 
@@ -1122,49 +1382,37 @@ do_where(int argc, const char ** argv)
 	{
 		fprintf(stderr, "Program name cannot include a path\n");
 
-		return;
+		return 1;
 	}
 
-	path = getenv("PATH");
-
-	fullPath = getChunk(strlen(path) + strlen(program) + 2);
-	path = chunkstrdup(path);
-
-	if ((path == NULL) || (fullPath == NULL))
-	{
-		fprintf(stderr, "Memory allocation failed\n");
+	/*
+	 * Get the list of directories in the PATH, which has already been
+	 * broken up and has had null directories changed to DOT.
+	 */
+	dirs = getPathDirs();
 
-		return;
-	}
+	if (dirs == NULL)
+		return 1;
 
 	/*
 	 * Check out each path to see if the program exists and is
 	 * executable in that path.
 	 */
-	for (; path; path = endPath)
+	for (; *dirs; dirs++)
 	{
 		/*
-		 * Find the end of the next path and NULL terminate
-		 * it if necessary.
+		 * Construct the full path of the program.
 		 */
-		endPath = strchr(path, ':');
-
-		if (endPath)
-			*endPath++ = '\0';
+		fullPath = getChunk(strlen(*dirs) + strlen(program) + 2);
 
-		/*
-		 * Get the directory name, defaulting it to DOT if
-		 * it is null.
-		 */
-		dirName = path;
+		if (fullPath == NULL)
+		{
+			fprintf(stderr, "Memory allocation failed\n");
 
-		if (dirName == '\0')
-			dirName = ".";
+			return 1;
+		}
 
-		/*
-		 * Construct the full path of the program.
-		 */
-		strcpy(fullPath, dirName);
+		strcpy(fullPath, *dirs);
 		strcat(fullPath, "/");
 		strcat(fullPath, program);
 
@@ -1184,12 +1432,20 @@ do_where(int argc, const char ** argv)
 	}
 
 	if (!found)
+	{
 		printf("Program \"%s\" not found in PATH\n", program);
+
+		return 1;
+	}
+
+	return 0;
 }
 
-#if HAVE_LINUX_LOSETUP
+#endif
+
+#if HAVE_LINUX_LOSETUP && CMD_LOSETUP
 
-void
+int
 do_losetup(int argc, const char ** argv)
 {
 	int loopfd;
@@ -1197,38 +1453,38 @@ do_losetup(int argc, const char ** argv)
 	struct loop_info loopInfo;
 
 	if (!strcmp(argv[1], "-d")) {
-		loopfd = open(argv[2], O_RDWR);
+		loopfd = openFile(argv[2], O_RDWR, 0);
 		if (loopfd < 0) {
 			fprintf(stderr, "Error opening %s: %s\n", argv[2], 
 				strerror(errno));
-			return;
+			return 1;
 		}
 
 		if (ioctl(loopfd, LOOP_CLR_FD, 0)) {
 			fprintf(stderr, "Error unassociating device: %s\n", 
 				strerror(errno));
-			return;
+			return 1;
 		}
 	}
 
-	loopfd = open(argv[1], O_RDWR);
+	loopfd = openFile(argv[1], O_RDWR, 0);
 	if (loopfd < 0) {
 		fprintf(stderr, "Error opening %s: %s\n", argv[1], 
 			strerror(errno));
-		return;
+		return 1;
 	}
 
-	targfd = open(argv[2], O_RDWR);
+	targfd = openFile(argv[2], O_RDWR, 0);
 	if (targfd < 0) {
 		fprintf(stderr, "Error opening %s: %s\n", argv[2], 
 			strerror(errno));
-		return;
+		return 1;
 	}
 
 	if (ioctl(loopfd, LOOP_SET_FD, targfd)) {
 		fprintf(stderr, "Error setting up loopback device: %s\n", 
 			strerror(errno));
-		return;
+		return 1;
 	}
 
 	memset(&loopInfo, 0, sizeof(loopInfo));
@@ -1237,10 +1493,10 @@ do_losetup(int argc, const char ** argv)
 	if (ioctl(loopfd, LOOP_SET_STATUS, &loopInfo)) {
 		fprintf(stderr, "Error setting up loopback device: %s\n", 
 			strerror(errno));
-		return;
+		return 1;
 	}
 
-	return;
+	return 0;
 }
 
 #endif
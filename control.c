@@ -0,0 +1,1441 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The "if", "for", and "while" control statements, functions, and
+ * lists of commands separated by ";", "&&", and "||".  The lines of a
+ * statement are collected until it is complete, and are then parsed into
+ * a tree whose simple commands are run using the normal command
+ * processing.  A loop or function body is parsed only once no matter
+ * how many times it is run, and no processes are started for the
+ * statements themselves.
+ */
+
+#include "sash.h"
+
+
+/*
+ * The kinds of words which are recognized at the start of a command.
+ */
+#define	KEY_NONE	0
+#define	KEY_IF		1
+#define	KEY_THEN	2
+#define	KEY_ELIF	3
+#define	KEY_ELSE	4
+#define	KEY_FI		5
+#define	KEY_FOR		6
+#define	KEY_WHILE	7
+#define	KEY_DO		8
+#define	KEY_DONE	9
+#define	KEY_FUNCTION	10
+#define	KEY_LBRACE	11
+#define	KEY_RBRACE	12
+#define	KEY_AND		13
+#define	KEY_OR		14
+
+#define	KEY_BIT(key)	(1 << (key))
+
+
+/*
+ * The kinds of nodes of a parsed statement.
+ */
+#define	NODE_COMMAND	0
+#define	NODE_IF		1
+#define	NODE_FOR	2
+#define	NODE_WHILE	3
+#define	NODE_AND	4
+#define	NODE_OR		5
+#define	NODE_FUNCTION	6
+
+
+/*
+ * The limit on how deeply functions can call each other.
+ */
+#define	MAX_CALL_DEPTH	100
+
+
+/*
+ * One keyword or simple command of the statement being collected.
+ * The text is the command, or the header of a for loop.
+ */
+typedef struct
+{
+	int	key;
+	char *	text;
+} Token;
+
+
+/*
+ * One node of a parsed statement.  The condition of an "if" or "while"
+ * node is a list of commands whose last exit status is checked, and
+ * the text is the command, the header of a "for" node, or the name of
+ * a function.  An "&&" or "||" node has its left side as the condition
+ * and its right side as the body.  A command is kept parsed in its line.
+ * A body which is also used by the function table has a use count which
+ * is the number of its users besides its node.
+ */
+typedef	struct	node	NODE;
+
+struct	node
+{
+	NODE *		next;
+	int		type;
+	char *		text;
+	ScriptLine *	line;
+	NODE *		cond;
+	NODE *		body;
+	NODE *		elseBody;
+	int		useCount;
+};
+
+
+/*
+ * A defined function.
+ */
+typedef struct
+{
+	char *	name;
+	NODE *	body;
+} Function;
+
+
+static	const char * const	keyNames[] =
+{
+	"", "if", "then", "elif", "else", "fi", "for", "while", "do", "done",
+	"function", "{", "}", "&&", "||"
+};
+
+
+/*
+ * The statement being collected.
+ */
+static	Token *	tokens;
+static	int	tokenCount;
+static	int	tokenTableSize;
+static	int	depth;
+
+
+/*
+ * The defined functions, and the positional parameters of the function
+ * which is running.
+ */
+static	Function *	functions;
+static	int		functionCount;
+static	int		functionTableSize;
+static	const char **	params;
+static	int		paramCount;
+static	int		callDepth;
+
+
+static	const char *	findOperator(const char * cmd);
+static	BOOL	isList(const char * cmd);
+static	BOOL	splitLine(const char * cmd);
+static	BOOL	addStatement(const char * str, int len);
+static	BOOL	addToken(int key, const char * str, int len);
+static	int	findKey(const char * str, int len);
+static	void	freeTokens(void);
+static	NODE *	parseList(int * posPtr, int stopKeys, BOOL * errorPtr);
+static	NODE *	parseItem(int * posPtr, BOOL * errorPtr);
+static	NODE *	parseIf(int * posPtr, BOOL * errorPtr);
+static	NODE *	parseLoop(int * posPtr, BOOL * errorPtr);
+static	BOOL	expectKey(int * posPtr, int key);
+static	NODE *	newNode(int type, char * text);
+static	void	freeNodes(NODE * node);
+static	void	releaseNodes(NODE * node);
+static	void	runNodes(const NODE * node);
+static	void	runFor(const NODE * node);
+static	void	defineFunction(const NODE * node);
+static	Function *	findFunction(const char * name, int len);
+
+
+/*
+ * Handle a command line if it is part of a control statement or is a
+ * list of commands.  If the line starts a statement or if a statement
+ * is being collected, then the line is added to it, and the statement
+ * is run once it is complete.  Returns TRUE if the line was handled
+ * here, or FALSE if it is an ordinary command.
+ */
+BOOL
+controlCommand(const char * cmd)
+{
+	NODE *	tree;
+	BOOL	error;
+	int	pos;
+
+	if ((tokenCount == 0) && (findKey(cmd, strcspn(cmd, " \t;")) ==
+		KEY_NONE) && !isList(cmd))
+	{
+		return FALSE;
+	}
+
+	if (!splitLine(cmd))
+	{
+		freeTokens();
+
+		return TRUE;
+	}
+
+	/*
+	 * Keep collecting lines if a statement is not finished or if
+	 * the line ends with an "&&" or "||" operator.
+	 */
+	if ((depth > 0) || ((tokenCount > 0) &&
+		((tokens[tokenCount - 1].key == KEY_AND) ||
+		(tokens[tokenCount - 1].key == KEY_OR))))
+	{
+		return TRUE;
+	}
+
+	/*
+	 * The statement is complete, so parse it and forget the collected
+	 * lines before running it, so that the commands being run can
+	 * have statements of their own.
+	 */
+	pos = 0;
+	error = FALSE;
+
+	tree = parseList(&pos, 0, &error);
+
+	if (!error && (pos < tokenCount))
+	{
+		fprintf(stderr, "Unexpected \"%s\"\n",
+			keyNames[tokens[pos].key]);
+		error = TRUE;
+	}
+
+	freeTokens();
+
+	if (error)
+	{
+		freeNodes(tree);
+		lastStatus = 2;
+
+		return TRUE;
+	}
+
+	runNodes(tree);
+	freeNodes(tree);
+
+	return TRUE;
+}
+
+
+/*
+ * Return TRUE if a control statement is being collected.
+ */
+BOOL
+controlPending(void)
+{
+	return (tokenCount > 0);
+}
+
+
+/*
+ * Forget any control statement which is being collected, complaining
+ * about it if specified.  This is done at the end of each input file.
+ */
+void
+endControl(BOOL complain)
+{
+	if (complain && (tokenCount > 0))
+	{
+		if (depth == 0)
+		{
+			fprintf(stderr, "Missing command after \"%s\"\n",
+				keyNames[tokens[tokenCount - 1].key]);
+		}
+		else
+		{
+			fprintf(stderr, "Missing \"%s\"\n",
+				(tokens[0].key == KEY_IF) ? "fi" :
+				(tokens[0].key == KEY_FUNCTION) ? "}" : "done");
+		}
+
+		lastStatus = 2;
+	}
+
+	freeTokens();
+}
+
+
+/*
+ * Find the next unquoted operator in a command line which is a
+ * semicolon, "&&", "||", or an ampersand which runs a command in the
+ * background.  The ampersands of redirections such as "2>&1", the
+ * bars of pipelines, and command substitutions are skipped.  Returns
+ * NULL if there is none.
+ */
+static const char *
+findOperator(const char * cmd)
+{
+	const char *	cp;
+	const char *	end;
+	int		quote;
+
+	quote = '\0';
+
+	for (cp = cmd; *cp; cp++)
+	{
+		if (*cp == '\\')
+		{
+			if (cp[1])
+				cp++;
+
+			continue;
+		}
+
+		if (quote)
+		{
+			if (*cp == quote)
+				quote = '\0';
+
+			continue;
+		}
+
+		if ((*cp == '\'') || (*cp == '"'))
+		{
+			quote = *cp;
+
+			continue;
+		}
+
+		end = endSubstitution(cp);
+
+		if (end)
+		{
+			cp = end;
+
+			continue;
+		}
+
+		if (*cp == ';')
+			return cp;
+
+		if ((*cp == '|') && (cp[1] == '|'))
+			return cp;
+
+		if (*cp != '&')
+			continue;
+
+		if (cp[1] == '&')
+			return cp;
+
+		if ((cp == cmd) || ((cp[-1] != '>') && (cp[-1] != '<')))
+			return cp;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Return TRUE if a command line is a list of commands to be run here.
+ * A list which has a command to be run in the background is left for
+ * the shell, so that the whole list is run in the background.
+ */
+static BOOL
+isList(const char * cmd)
+{
+	const char *	cp;
+	BOOL		found;
+
+	found = FALSE;
+
+	for (cp = findOperator(cmd); cp; cp = findOperator(cp))
+	{
+		if ((*cp == '&') && (cp[1] != '&'))
+			return FALSE;
+
+		found = TRUE;
+		cp += (*cp == ';') ? 1 : 2;
+	}
+
+	return found;
+}
+
+
+/*
+ * Split a command line into its statements at unquoted semicolons,
+ * "&&", and "||" operators, and add them to the statement being
+ * collected.  Returns FALSE with a message output on an error.
+ */
+static BOOL
+splitLine(const char * cmd)
+{
+	const char *	cp;
+	int		key;
+
+	cp = findOperator(cmd);
+
+	while (cp)
+	{
+		/*
+		 * A background command stays part of its statement.
+		 */
+		if ((*cp == '&') && (cp[1] != '&'))
+		{
+			cp = findOperator(cp + 1);
+
+			continue;
+		}
+
+		if (!addStatement(cmd, cp - cmd))
+			return FALSE;
+
+		cmd = cp + 1;
+
+		if (*cp != ';')
+		{
+			key = (*cp == '&') ? KEY_AND : KEY_OR;
+
+			if (!addToken(key, NULL, 0))
+				return FALSE;
+
+			cmd = cp + 2;
+		}
+
+		cp = findOperator(cmd);
+	}
+
+	return addStatement(cmd, strlen(cmd));
+}
+
+
+/*
+ * Add one statement to the statement being collected, separating the
+ * keywords at its start from the command which follows them.
+ * Returns FALSE with a message output on an error.
+ */
+static BOOL
+addStatement(const char * str, int len)
+{
+	int	wordLen;
+	int	key;
+
+	while (TRUE)
+	{
+		while ((len > 0) && isBlank(*str))
+		{
+			str++;
+			len--;
+		}
+
+		while ((len > 0) && isBlank(str[len - 1]))
+			len--;
+
+		if ((len == 0) || (*str == '#'))
+			return TRUE;
+
+		wordLen = 0;
+
+		while ((wordLen < len) && !isBlank(str[wordLen]))
+			wordLen++;
+
+		key = findKey(str, wordLen);
+
+		if (key == KEY_NONE)
+			return addToken(KEY_NONE, str, len);
+
+		str += wordLen;
+		len -= wordLen;
+
+		/*
+		 * The rest of a "for" statement is its header.
+		 */
+		if (key == KEY_FOR)
+			return addToken(KEY_FOR, str, len);
+
+		/*
+		 * A function keyword is followed by the name of the function.
+		 */
+		if (key == KEY_FUNCTION)
+		{
+			while ((len > 0) && isBlank(*str))
+			{
+				str++;
+				len--;
+			}
+
+			wordLen = 0;
+
+			while ((wordLen < len) && !isBlank(str[wordLen]) &&
+				(str[wordLen] != '{'))
+			{
+				wordLen++;
+			}
+
+			if (wordLen == 0)
+			{
+				fprintf(stderr, "Missing function name\n");
+
+				return FALSE;
+			}
+
+			if (!addToken(KEY_FUNCTION, str, wordLen))
+				return FALSE;
+
+			str += wordLen;
+			len -= wordLen;
+
+			continue;
+		}
+
+		if (!addToken(key, NULL, 0))
+			return FALSE;
+
+		if ((key == KEY_FI) || (key == KEY_DONE) || (key == KEY_RBRACE))
+		{
+			if (depth < 0)
+			{
+				fprintf(stderr, "Unexpected \"%s\"\n",
+					keyNames[key]);
+
+				return FALSE;
+			}
+		}
+	}
+}
+
+
+/*
+ * Add a keyword or command to the statement being collected,
+ * keeping track of how deeply the statements are nested.
+ * Returns FALSE with a message output if there is no memory.
+ */
+static BOOL
+addToken(int key, const char * str, int len)
+{
+	Token *	newTokens;
+	Token *	token;
+	int	newSize;
+
+	if (tokenCount >= tokenTableSize)
+	{
+		newSize = tokenTableSize * 2 + 16;
+
+		newTokens = (Token *) realloc(tokens, sizeof(Token) * newSize);
+
+		if (newTokens == NULL)
+		{
+			fprintf(stderr, "No memory for statement\n");
+
+			return FALSE;
+		}
+
+		tokens = newTokens;
+		tokenTableSize = newSize;
+	}
+
+	token = &tokens[tokenCount];
+
+	token->key = key;
+	token->text = NULL;
+
+	if (str)
+	{
+		token->text = malloc(len + 1);
+
+		if (token->text == NULL)
+		{
+			fprintf(stderr, "No memory for statement\n");
+
+			return FALSE;
+		}
+
+		memcpy(token->text, str, len);
+		token->text[len] = '\0';
+	}
+
+	tokenCount++;
+
+	if ((key == KEY_IF) || (key == KEY_FOR) || (key == KEY_WHILE) ||
+		(key == KEY_FUNCTION))
+	{
+		depth++;
+	}
+
+	if ((key == KEY_FI) || (key == KEY_DONE) || (key == KEY_RBRACE))
+		depth--;
+
+	return TRUE;
+}
+
+
+/*
+ * Return the keyword which is the specified number of characters of
+ * a string, or KEY_NONE if it is not a keyword.
+ */
+static int
+findKey(const char * str, int len)
+{
+	int	key;
+
+	for (key = KEY_IF; key <= KEY_RBRACE; key++)
+	{
+		if (((int) strlen(keyNames[key]) == len) &&
+			(memcmp(str, keyNames[key], len) == 0))
+		{
+			return key;
+		}
+	}
+
+	return KEY_NONE;
+}
+
+
+/*
+ * Free the statement being collected.
+ */
+static void
+freeTokens(void)
+{
+	int	i;
+
+	for (i = 0; i < tokenCount; i++)
+		free(tokens[i].text);
+
+	tokenCount = 0;
+	depth = 0;
+}
+
+
+/*
+ * Parse a list of commands and statements until one of the specified
+ * keywords or the end of the statement is reached.  The error flag is
+ * set with a message output on an error.
+ */
+static NODE *
+parseList(int * posPtr, int stopKeys, BOOL * errorPtr)
+{
+	Token *	token;
+	NODE *	head;
+	NODE **	link;
+	NODE *	node;
+	NODE *	andOr;
+	int	key;
+
+	head = NULL;
+	link = &head;
+
+	while (!*errorPtr && (*posPtr < tokenCount))
+	{
+		if (KEY_BIT(tokens[*posPtr].key) & stopKeys)
+			break;
+
+		node = parseItem(posPtr, errorPtr);
+
+		/*
+		 * Join the items separated by "&&" or "||" operators,
+		 * which are evaluated from left to right.
+		 */
+		while (node && !*errorPtr && (*posPtr < tokenCount))
+		{
+			key = tokens[*posPtr].key;
+
+			if ((key != KEY_AND) && (key != KEY_OR))
+				break;
+
+			(*posPtr)++;
+
+			andOr = newNode((key == KEY_AND) ? NODE_AND : NODE_OR,
+				NULL);
+
+			if (andOr == NULL)
+			{
+				freeNodes(node);
+				node = NULL;
+
+				break;
+			}
+
+			andOr->cond = node;
+			node = andOr;
+
+			token = (*posPtr < tokenCount) ? &tokens[*posPtr] : NULL;
+
+			if ((token == NULL) || (KEY_BIT(token->key) & stopKeys))
+			{
+				fprintf(stderr, "Missing command after \"%s\"\n",
+					keyNames[key]);
+
+				*errorPtr = TRUE;
+
+				break;
+			}
+
+			node->body = parseItem(posPtr, errorPtr);
+
+			if (node->body == NULL)
+				*errorPtr = TRUE;
+		}
+
+		if (node == NULL)
+		{
+			*errorPtr = TRUE;
+
+			break;
+		}
+
+		*link = node;
+		link = &node->next;
+	}
+
+	return head;
+}
+
+
+/*
+ * Parse one simple command or statement.  Returns NULL with the error
+ * flag set and a message output on an error.
+ */
+static NODE *
+parseItem(int * posPtr, BOOL * errorPtr)
+{
+	Token *	token;
+	NODE *	node;
+
+	token = &tokens[(*posPtr)++];
+
+	switch (token->key)
+	{
+		case KEY_NONE:
+			node = newNode(NODE_COMMAND, token->text);
+			token->text = NULL;
+			break;
+
+		case KEY_IF:
+			node = parseIf(posPtr, errorPtr);
+			break;
+
+		case KEY_FOR:
+			node = newNode(NODE_FOR, token->text);
+			token->text = NULL;
+
+			if (node)
+				node->body = parseLoop(posPtr, errorPtr);
+			break;
+
+		case KEY_WHILE:
+			node = newNode(NODE_WHILE, NULL);
+
+			if (node)
+			{
+				node->cond = parseList(posPtr, KEY_BIT(KEY_DO),
+					errorPtr);
+
+				node->body = parseLoop(posPtr, errorPtr);
+			}
+			break;
+
+		case KEY_FUNCTION:
+			node = newNode(NODE_FUNCTION, token->text);
+			token->text = NULL;
+
+			if (node == NULL)
+				break;
+
+			if (!expectKey(posPtr, KEY_LBRACE))
+			{
+				*errorPtr = TRUE;
+
+				break;
+			}
+
+			node->body = parseList(posPtr, KEY_BIT(KEY_RBRACE),
+				errorPtr);
+
+			if (!*errorPtr && !expectKey(posPtr, KEY_RBRACE))
+				*errorPtr = TRUE;
+			break;
+
+		default:
+			fprintf(stderr, "Unexpected \"%s\"\n",
+				keyNames[token->key]);
+
+			*errorPtr = TRUE;
+			node = NULL;
+			break;
+	}
+
+	if (node == NULL)
+		*errorPtr = TRUE;
+
+	return node;
+}
+
+
+/*
+ * Parse the rest of an "if" statement after its "if" or "elif" keyword.
+ * An "elif" is parsed as another "if" statement which is the else part.
+ */
+static NODE *
+parseIf(int * posPtr, BOOL * errorPtr)
+{
+	NODE *	node;
+
+	node = newNode(NODE_IF, NULL);
+
+	if (node == NULL)
+		return NULL;
+
+	node->cond = parseList(posPtr, KEY_BIT(KEY_THEN), errorPtr);
+
+	if (*errorPtr || (node->cond == NULL) || !expectKey(posPtr, KEY_THEN))
+	{
+		*errorPtr = TRUE;
+
+		return node;
+	}
+
+	node->body = parseList(posPtr,
+		KEY_BIT(KEY_ELIF) | KEY_BIT(KEY_ELSE) | KEY_BIT(KEY_FI),
+		errorPtr);
+
+	if (*errorPtr)
+		return node;
+
+	if ((*posPtr < tokenCount) && (tokens[*posPtr].key == KEY_ELIF))
+	{
+		(*posPtr)++;
+		node->elseBody = parseIf(posPtr, errorPtr);
+
+		if (node->elseBody == NULL)
+			*errorPtr = TRUE;
+
+		return node;
+	}
+
+	if ((*posPtr < tokenCount) && (tokens[*posPtr].key == KEY_ELSE))
+	{
+		(*posPtr)++;
+		node->elseBody = parseList(posPtr, KEY_BIT(KEY_FI), errorPtr);
+	}
+
+	if (!*errorPtr && !expectKey(posPtr, KEY_FI))
+		*errorPtr = TRUE;
+
+	return node;
+}
+
+
+/*
+ * Parse the "do" part of a loop up to its "done" keyword.
+ */
+static NODE *
+parseLoop(int * posPtr, BOOL * errorPtr)
+{
+	NODE *	body;
+
+	if (*errorPtr || !expectKey(posPtr, KEY_DO))
+	{
+		*errorPtr = TRUE;
+
+		return NULL;
+	}
+
+	body = parseList(posPtr, KEY_BIT(KEY_DONE), errorPtr);
+
+	if (!*errorPtr && !expectKey(posPtr, KEY_DONE))
+		*errorPtr = TRUE;
+
+	return body;
+}
+
+
+/*
+ * Check that the next token is the specified keyword and skip over it.
+ * Returns FALSE with a message output if it is not.
+ */
+static BOOL
+expectKey(int * posPtr, int key)
+{
+	if ((*posPtr < tokenCount) && (tokens[*posPtr].key == key))
+	{
+		(*posPtr)++;
+
+		return TRUE;
+	}
+
+	if (*posPtr < tokenCount)
+	{
+		fprintf(stderr, "Expected \"%s\" instead of \"%s\"\n",
+			keyNames[key], tokens[*posPtr].key ?
+				keyNames[tokens[*posPtr].key] :
+				tokens[*posPtr].text);
+	}
+	else
+		fprintf(stderr, "Missing \"%s\"\n", keyNames[key]);
+
+	return FALSE;
+}
+
+
+/*
+ * Allocate a new node which takes over the specified text.
+ * Returns NULL with a message output if there is no memory.
+ */
+static NODE *
+newNode(int type, char * text)
+{
+	NODE *	node;
+
+	node = (NODE *) calloc(1, sizeof(NODE));
+
+	if (node == NULL)
+	{
+		fprintf(stderr, "No memory for statement\n");
+		free(text);
+
+		return NULL;
+	}
+
+	node->type = type;
+	node->text = text;
+
+	if (type == NODE_COMMAND)
+	{
+		node->line = newScriptLine(text);
+
+		if (node->line == NULL)
+		{
+			free(text);
+			free((char *) node);
+
+			return NULL;
+		}
+	}
+
+	return node;
+}
+
+
+/*
+ * Free a list of nodes along with all of their parts.
+ */
+static void
+freeNodes(NODE * node)
+{
+	NODE *	next;
+
+	while (node)
+	{
+		next = node->next;
+
+		freeNodes(node->cond);
+		releaseNodes(node->body);
+		freeNodes(node->elseBody);
+		freeScriptLine(node->line);
+		free(node->text);
+		free((char *) node);
+
+		node = next;
+	}
+}
+
+
+/*
+ * Release one use of a body, freeing it if there are no other users.
+ */
+static void
+releaseNodes(NODE * node)
+{
+	if (node && (node->useCount > 0))
+		node->useCount--;
+	else
+		freeNodes(node);
+}
+
+
+/*
+ * Run a list of parsed commands and statements, stopping early if
+ * there is an interrupt.
+ */
+static void
+runNodes(const NODE * node)
+{
+	int	status;
+
+	for (; node && !intFlag; node = node->next)
+	{
+		switch (node->type)
+		{
+			case NODE_COMMAND:
+				runScriptLine(node->line);
+				break;
+
+			case NODE_IF:
+				runNodes(node->cond);
+
+				if (intFlag)
+					break;
+
+				if (lastStatus == 0)
+					runNodes(node->body);
+				else if (node->elseBody)
+					runNodes(node->elseBody);
+				else
+					lastStatus = 0;
+				break;
+
+			case NODE_WHILE:
+				status = 0;
+
+				while (TRUE)
+				{
+					runNodes(node->cond);
+
+					if (intFlag || lastStatus)
+						break;
+
+					runNodes(node->body);
+					status = lastStatus;
+
+					if (intFlag)
+						break;
+				}
+
+				lastStatus = status;
+				break;
+
+			case NODE_FOR:
+				runFor(node);
+				break;
+
+			case NODE_AND:
+				runNodes(node->cond);
+
+				if (!intFlag && (lastStatus == 0))
+					runNodes(node->body);
+				break;
+
+			case NODE_OR:
+				runNodes(node->cond);
+
+				if (!intFlag && (lastStatus != 0))
+					runNodes(node->body);
+				break;
+
+			case NODE_FUNCTION:
+				defineFunction(node);
+				break;
+		}
+	}
+}
+
+
+/*
+ * Run a "for" loop, whose header is the variable name followed by "in"
+ * and the list of words to be expanded.  The variable is an environment
+ * variable.  It is set by rewriting a single "name=value" string which
+ * is in the environment, so that each pass through the loop does not
+ * allocate a new copy of the variable.
+ */
+static void
+runFor(const NODE * node)
+{
+	extern char **	environ;
+	char **		env;
+	const char *	cp;
+	const char *	words;
+	const char **	argv;
+	char *		var;
+	char *		name;
+	int		nameLen;
+	int		maxLen;
+	int		argc;
+	int		status;
+	int		i;
+
+	cp = node->text;
+
+	while (isBlank(*cp))
+		cp++;
+
+	nameLen = 0;
+
+	while (isalnum((unsigned char) cp[nameLen]) || (cp[nameLen] == '_'))
+		nameLen++;
+
+	words = cp + nameLen;
+
+	while (isBlank(*words))
+		words++;
+
+	if ((nameLen == 0) || isDecimal(*cp) || (strncmp(words, "in", 2) != 0)
+		|| (words[2] && !isBlank(words[2])))
+	{
+		fprintf(stderr, "Bad for loop header \"%s\"\n", cp);
+		lastStatus = 2;
+
+		return;
+	}
+
+	/*
+	 * Expand the list of words and copy the result since the
+	 * commands of the loop use the same storage.
+	 */
+	words += 2;
+
+	while (isBlank(*words))
+		words++;
+
+	words = expandVariables(words);
+
+	if (words == NULL)
+	{
+		lastStatus = 1;
+
+		return;
+	}
+
+	argc = 0;
+	argv = NULL;
+
+	if (*words && !makeArgs(words, &argc, &argv))
+	{
+		lastStatus = 1;
+
+		return;
+	}
+
+	argv = copyArgs(argc, argv);
+
+	if (argv == NULL)
+	{
+		lastStatus = 1;
+
+		return;
+	}
+
+	maxLen = 0;
+
+	for (i = 0; i < argc; i++)
+		maxLen = MAX(maxLen, (int) strlen(argv[i]));
+
+	/*
+	 * The string for the environment is followed by a separate copy
+	 * of the name, which is used when the string is taken back out.
+	 */
+	var = malloc(nameLen + maxLen + 2 + nameLen + 1);
+
+	if (var == NULL)
+	{
+		fprintf(stderr, "No memory for loop variable\n");
+		free((char *) argv);
+		lastStatus = 1;
+
+		return;
+	}
+
+	memcpy(var, cp, nameLen);
+	var[nameLen] = '=';
+
+	name = var + nameLen + maxLen + 2;
+	memcpy(name, cp, nameLen);
+	name[nameLen] = '\0';
+
+	status = 0;
+
+	for (i = 0; (i < argc) && !intFlag; i++)
+	{
+		strcpy(var + nameLen + 1, argv[i]);
+
+		/*
+		 * Put the string back into the environment if a command
+		 * of the loop has replaced it.
+		 */
+		for (env = environ; *env && (*env != var); env++)
+			;
+
+		if (*env == NULL)
+			putenv(var);
+
+		runNodes(node->body);
+		status = lastStatus;
+	}
+
+	/*
+	 * If the string is still in the environment then replace it with
+	 * a copy of its last value so that the string can be freed.
+	 * The string itself must not be changed while it is there.
+	 */
+	for (env = environ; *env && (*env != var); env++)
+		;
+
+	if (*env)
+		setenv(name, var + nameLen + 1, 1);
+
+	free(var);
+	free((char *) argv);
+
+	lastStatus = status;
+}
+
+
+/*
+ * Define a function, replacing any function of the same name.
+ * The function shares the body of the node.
+ */
+static void
+defineFunction(const NODE * node)
+{
+	Function *	func;
+	Function *	newFunctions;
+	int		newSize;
+
+	if (isBuiltIn(node->text))
+	{
+		fprintf(stderr, "%s: Is a built-in command\n", node->text);
+		lastStatus = 1;
+
+		return;
+	}
+
+	func = findFunction(node->text, strlen(node->text));
+
+	if (func == NULL)
+	{
+		if (functionCount >= functionTableSize)
+		{
+			newSize = functionTableSize * 2 + 16;
+
+			newFunctions = (Function *) realloc(functions,
+				sizeof(Function) * newSize);
+
+			if (newFunctions == NULL)
+			{
+				fprintf(stderr, "No memory for function\n");
+				lastStatus = 1;
+
+				return;
+			}
+
+			functions = newFunctions;
+			functionTableSize = newSize;
+		}
+
+		func = &functions[functionCount];
+
+		func->name = strdup(node->text);
+		func->body = NULL;
+
+		if (func->name == NULL)
+		{
+			fprintf(stderr, "No memory for function\n");
+			lastStatus = 1;
+
+			return;
+		}
+
+		functionCount++;
+	}
+
+	releaseNodes(func->body);
+
+	func->body = node->body;
+
+	if (func->body)
+		func->body->useCount++;
+
+	lastStatus = 0;
+}
+
+
+/*
+ * Find the function with the specified name, which need not be null
+ * terminated.  Returns NULL if there is none.
+ */
+static Function *
+findFunction(const char * name, int len)
+{
+	Function *	func;
+
+	for (func = functions; func < &functions[functionCount]; func++)
+	{
+		if ((memcmp(func->name, name, len) == 0) &&
+			(func->name[len] == '\0'))
+		{
+			return func;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Return TRUE if a command is a call of a function.
+ */
+BOOL
+isFunction(const char * cmd)
+{
+	if (functionCount == 0)
+		return FALSE;
+
+	return (findFunction(cmd, strcspn(cmd, " \t")) != NULL);
+}
+
+
+/*
+ * Try to call a function with the arguments of a command, which become
+ * its positional parameters while it runs.  Returns TRUE if the command
+ * is a function, with its exit status stored through the pointer, or
+ * FALSE if it is not a function.
+ */
+BOOL
+runFunction(const char * cmd, int * statusPtr)
+{
+	Function *	func;
+	NODE *		body;
+	const char **	oldParams;
+	const char **	argv;
+	int		oldCount;
+	int		argc;
+
+	if (functionCount == 0)
+		return FALSE;
+
+	func = findFunction(cmd, strcspn(cmd, " \t"));
+
+	if (func == NULL)
+		return FALSE;
+
+	*statusPtr = 1;
+
+	if (callDepth >= MAX_CALL_DEPTH)
+	{
+		fprintf(stderr, "Functions nested too deeply\n");
+
+		return TRUE;
+	}
+
+	/*
+	 * The arguments are copied since the commands of the function
+	 * use the same storage.
+	 */
+	if (!makeArgs(cmd, &argc, &argv))
+		return TRUE;
+
+	argv = copyArgs(argc, argv);
+
+	if (argv == NULL)
+		return TRUE;
+
+	/*
+	 * Keep the body while it runs even if the function is redefined.
+	 */
+	body = func->body;
+
+	if (body)
+		body->useCount++;
+
+	oldParams = params;
+	oldCount = paramCount;
+
+	params = argv;
+	paramCount = argc;
+	callDepth++;
+
+	lastStatus = 0;
+
+	runNodes(body);
+
+	callDepth--;
+	params = oldParams;
+	paramCount = oldCount;
+
+	releaseNodes(body);
+	free((char *) argv);
+
+	*statusPtr = lastStatus;
+
+	return TRUE;
+}
+
+
+/*
+ * Return the value of a positional parameter of the running function,
+ * which is a number, or "#" for the number of parameters, or "@" or "*"
+ * for all of them separated by spaces.  The name need not be null
+ * terminated.  A parameter which is not given has an empty value.
+ * Returns NULL if no function is running or if this is not the name
+ * of a parameter.  The value can be in static storage.
+ */
+const char *
+findParameter(const char * name, int len)
+{
+	static char	countBuf[16];
+	static char *	allBuf;
+	static int	allSize;
+	char *		newBuf;
+	char *		cp;
+	int		index;
+	int		size;
+	int		i;
+
+	if (callDepth == 0)
+		return NULL;
+
+	if ((len == 1) && (*name == '#'))
+	{
+		sprintf(countBuf, "%d", paramCount - 1);
+
+		return countBuf;
+	}
+
+	if ((len == 1) && ((*name == '@') || (*name == '*')))
+	{
+		size = 1;
+
+		for (i = 1; i < paramCount; i++)
+			size += strlen(params[i]) + 1;
+
+		if (size > allSize)
+		{
+			newBuf = realloc(allBuf, size);
+
+			if (newBuf == NULL)
+			{
+				fprintf(stderr, "No memory for parameters\n");
+
+				return "";
+			}
+
+			allBuf = newBuf;
+			allSize = size;
+		}
+
+		cp = allBuf;
+
+		for (i = 1; i < paramCount; i++)
+		{
+			if (i > 1)
+				*cp++ = ' ';
+
+			strcpy(cp, params[i]);
+			cp += strlen(cp);
+		}
+
+		*cp = '\0';
+
+		return allBuf;
+	}
+
+	index = 0;
+
+	for (i = 0; i < len; i++)
+	{
+		if (!isDecimal(name[i]))
+			return NULL;
+
+		index = index * 10 + name[i] - '0';
+	}
+
+	if (index >= paramCount)
+		return "";
+
+	return params[index];
+}
+
+/* END CODE */
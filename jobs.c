@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The table of commands running in the background, and the "jobs"
+ * and "wait" built-in commands.  Finished background processes are
+ * reaped by the SIGCHLD signal handler as soon as they exit, and the
+ * finished jobs are reported before the next prompt.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "sash.h"
+
+
+#define	MAX_JOBS	32
+
+
+/*
+ * One background job, which is a command or pipeline.
+ * The fields changed by the signal handler are volatile.
+ */
+typedef struct
+{
+	int			id;
+	char *			cmd;
+	pid_t *			pids;
+	int			pidCount;
+	volatile int		running;
+	volatile int		status;
+} Job;
+
+
+static	Job	jobTable[MAX_JOBS];
+static	int	jobCount;
+
+
+static	void	catchChild(int sig);
+static	Job *	findJob(const char * str);
+static	void	waitJob(const Job * job);
+static	void	removeJob(Job * job);
+static	const char *	jobState(const Job * job);
+static	int	exitStatus(int status);
+
+
+/*
+ * Set up the signal handler which reaps the background jobs.
+ */
+void
+initJobs(void)
+{
+	struct sigaction	act;
+
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = catchChild;
+	act.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigemptyset(&act.sa_mask);
+
+	sigaction(SIGCHLD, &act, NULL);
+}
+
+
+/*
+ * Block or unblock the SIGCHLD signal so that the job table can be
+ * changed, or so that a job can be started without being reaped yet.
+ */
+void
+blockJobSignal(BOOL block)
+{
+	sigset_t	set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+
+	sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, NULL);
+}
+
+
+/*
+ * Add a started background job to the table and tell the user about it.
+ * This should be called with the SIGCHLD signal blocked.
+ * Returns TRUE if successful, or FALSE with a message output if the
+ * table is full, in which case the processes are left to themselves.
+ */
+BOOL
+addJob(const char * cmd, const pid_t * pids, int pidCount)
+{
+	Job *	job;
+	int	id;
+	int	i;
+
+	/*
+	 * Forget any finished jobs if the table is full.
+	 */
+	for (i = jobCount - 1; (jobCount >= MAX_JOBS) && (i >= 0); i--)
+	{
+		if (jobTable[i].running == 0)
+			removeJob(&jobTable[i]);
+	}
+
+	if (jobCount >= MAX_JOBS)
+	{
+		fprintf(stderr, "Too many background jobs\n");
+
+		return FALSE;
+	}
+
+	/*
+	 * The new job gets the next number after the newest job.
+	 */
+	id = 1;
+
+	if (jobCount > 0)
+		id = jobTable[jobCount - 1].id + 1;
+
+	job = &jobTable[jobCount];
+
+	job->cmd = strdup(cmd);
+	job->pids = (pid_t *) malloc(sizeof(pid_t) * pidCount);
+
+	if ((job->cmd == NULL) || (job->pids == NULL))
+	{
+		fprintf(stderr, "No memory for background job\n");
+		free(job->cmd);
+		free((char *) job->pids);
+
+		return FALSE;
+	}
+
+	memcpy((void *) job->pids, (const void *) pids,
+		sizeof(pid_t) * pidCount);
+
+	job->id = id;
+	job->pidCount = pidCount;
+	job->running = pidCount;
+	job->status = 0;
+
+	jobCount++;
+
+	printf("[%d] %ld\n", id, (long) pids[pidCount - 1]);
+
+	return TRUE;
+}
+
+
+/*
+ * Report and forget the jobs which have finished.
+ */
+void
+reportJobs(void)
+{
+	Job *	job;
+	int	i;
+
+	blockJobSignal(TRUE);
+
+	for (i = 0; i < jobCount; )
+	{
+		job = &jobTable[i];
+
+		if (job->running)
+		{
+			i++;
+
+			continue;
+		}
+
+		printf("[%d] %-10s %s\n", job->id, jobState(job), job->cmd);
+
+		removeJob(job);
+	}
+
+	blockJobSignal(FALSE);
+
+	fflush(stdout);
+}
+
+
+int
+do_jobs(int argc, const char ** argv)
+{
+	Job *	job;
+	int	i;
+
+	blockJobSignal(TRUE);
+
+	for (i = 0; i < jobCount; )
+	{
+		job = &jobTable[i];
+
+		printf("[%d] %-10s %s\n", job->id, jobState(job), job->cmd);
+
+		if (job->running)
+			i++;
+		else
+			removeJob(job);
+	}
+
+	blockJobSignal(FALSE);
+
+	return 0;
+}
+
+
+int
+do_wait(int argc, const char ** argv)
+{
+	Job *	job;
+	int	r;
+
+	r = 0;
+
+	/*
+	 * With no arguments, wait for all of the jobs.
+	 */
+	if (argc == 1)
+	{
+		while (!intFlag && (jobCount > 0))
+		{
+			waitJob(&jobTable[0]);
+
+			if (intFlag)
+				break;
+
+			blockJobSignal(TRUE);
+			removeJob(&jobTable[0]);
+			blockJobSignal(FALSE);
+		}
+
+		return intFlag ? 1 : 0;
+	}
+
+	/*
+	 * Otherwise the status is that of the last job waited for.
+	 */
+	while (!intFlag && (argc-- > 1))
+	{
+		job = findJob(*++argv);
+
+		if (job == NULL)
+		{
+			fprintf(stderr, "%s: No such job\n", *argv);
+			r = 127;
+
+			continue;
+		}
+
+		waitJob(job);
+
+		if (intFlag)
+			break;
+
+		r = exitStatus(job->status);
+
+		blockJobSignal(TRUE);
+		removeJob(job);
+		blockJobSignal(FALSE);
+	}
+
+	return intFlag ? 1 : r;
+}
+
+
+/*
+ * Reap any of the processes of background jobs which have finished.
+ * The exit status of a job is that of the last process of it.
+ */
+static void
+catchChild(int sig)
+{
+	Job *	job;
+	pid_t	pid;
+	int	savedErrno;
+	int	status;
+	int	i;
+	int	j;
+
+	savedErrno = errno;
+
+	for (i = 0; i < jobCount; i++)
+	{
+		job = &jobTable[i];
+
+		for (j = 0; j < job->pidCount; j++)
+		{
+			if (job->pids[j] <= 0)
+				continue;
+
+			status = 0;
+			pid = waitProcess(job->pids[j], &status, WNOHANG);
+
+			if ((pid == 0) || ((pid < 0) && (errno == EINTR)))
+				continue;
+
+			if (j == job->pidCount - 1)
+				job->status = status;
+
+			job->pids[j] = 0;
+			job->running--;
+		}
+	}
+
+	errno = savedErrno;
+}
+
+
+/*
+ * Find the job specified by a job number, optionally preceded by a
+ * percent sign, or else by the process id of one of its processes.
+ */
+static Job *
+findJob(const char * str)
+{
+	Job *	job;
+	long	value;
+	int	i;
+	int	j;
+
+	if (*str == '%')
+		str++;
+
+	if (!isDecimal(*str))
+		return NULL;
+
+	value = atol(str);
+
+	for (i = 0; i < jobCount; i++)
+	{
+		if (jobTable[i].id == value)
+			return &jobTable[i];
+	}
+
+	for (i = 0; i < jobCount; i++)
+	{
+		job = &jobTable[i];
+
+		for (j = 0; j < job->pidCount; j++)
+		{
+			if (job->pids[j] == value)
+				return job;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Wait for all of the processes of a job to finish or for an interrupt.
+ * The signal handler does the reaping, so this just sleeps until it
+ * has run.
+ */
+static void
+waitJob(const Job * job)
+{
+	sigset_t	oldSet;
+	sigset_t	set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+
+	sigprocmask(SIG_BLOCK, &set, &oldSet);
+
+	while (job->running && !intFlag)
+		sigsuspend(&oldSet);
+
+	sigprocmask(SIG_SETMASK, &oldSet, NULL);
+}
+
+
+/*
+ * Remove a job from the table, keeping the rest of the jobs in order.
+ * This should be called with the SIGCHLD signal blocked.
+ */
+static void
+removeJob(Job * job)
+{
+	int	index;
+
+	free(job->cmd);
+	free((char *) job->pids);
+
+	index = job - jobTable;
+
+	memmove((void *) job, (const void *) (job + 1),
+		sizeof(Job) * (jobCount - index - 1));
+
+	jobCount--;
+}
+
+
+/*
+ * Return a description of the state of a job.
+ */
+static const char *
+jobState(const Job * job)
+{
+	static char	buf[32];
+
+	if (job->running)
+		return "Running";
+
+	if (WIFSIGNALED(job->status))
+	{
+		sprintf(buf, "Signal %d", WTERMSIG(job->status));
+
+		return buf;
+	}
+
+	if (WEXITSTATUS(job->status))
+	{
+		sprintf(buf, "Exit %d", WEXITSTATUS(job->status));
+
+		return buf;
+	}
+
+	return "Done";
+}
+
+
+/*
+ * Convert a wait status into the exit status of a command.
+ */
+static int
+exitStatus(int status)
+{
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+
+	return WEXITSTATUS(status);
+}
+
+/* END CODE */
@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Check that sash runs a command line of one megabyte correctly when it
+# is read from a pipe, run as a script file, and sourced.  The line is a
+# -echo of many words, and its output must be exactly those words.
+#
+# Usage: longline.sh
+#
+
+BYTES=1048576
+
+if [ ! -x ./sash ]
+then
+	echo "longline.sh: sash has not been built" >&2
+	exit 1
+fi
+
+tmp=${TMPDIR:-/tmp}/sash-longline.$$
+trap 'rm -f $tmp.words $tmp.script $tmp.out' 0
+
+awk -v bytes=$BYTES 'BEGIN {
+	len = 0
+	for (i = 0; len < bytes; i++) {
+		word = sprintf("word%07d", i)
+		printf "%s%s", (i ? " " : ""), word
+		len += length(word) + 1
+	}
+	printf "\n"
+}' > $tmp.words
+
+(printf -- '-echo '; cat $tmp.words) > $tmp.script
+
+status=0
+
+for how in pipe script source
+do
+	case $how in
+	pipe)
+		cat $tmp.script | ./sash -q > $tmp.out 2>&1
+		;;
+	script)
+		./sash -q $tmp.script > $tmp.out 2>&1
+		;;
+	source)
+		./sash -q -c "source $tmp.script" > $tmp.out 2>&1
+		;;
+	esac
+
+	if cmp -s $tmp.words $tmp.out
+	then
+		echo "longline.sh: `wc -c < $tmp.script` byte line by $how: ok"
+	else
+		echo "longline.sh: `wc -c < $tmp.script` byte line by $how: FAILED"
+		status=1
+	fi
+done
+
+exit $status
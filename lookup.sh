@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# Benchmark the lookup of built-in commands by timing a script which
+# runs a cheap built-in command many times.  Each sash binary given is
+# timed in turn, so that an older build can be compared with this one.
+#
+# Usage: lookup.sh [sash ...]
+#
+
+LINES=300000
+RUNS=5
+
+tmp=${TMPDIR:-/tmp}/sash-lookup.$$
+trap 'rm -f $tmp' 0
+
+awk -v lines=$LINES 'BEGIN { for (i = 0; i < lines; i++) print "umask 022" }' > $tmp
+
+for sash in ${*:-./sash}
+do
+	if [ ! -x $sash ]
+	then
+		echo "lookup.sh: $sash has not been built" >&2
+		exit 1
+	fi
+
+	best=
+
+	i=0
+
+	while [ $i -lt $RUNS ]
+	do
+		start=`date +%s%N`
+		$sash -q < $tmp
+		end=`date +%s%N`
+
+		time=`expr \( $end - $start \) / 1000`
+
+		if [ -z "$best" ] || [ $time -lt $best ]
+		then
+			best=$time
+		fi
+
+		i=`expr $i + 1`
+	done
+
+	echo "$sash: $LINES built-in commands in $best microseconds," \
+		"`expr $best \* 1000 / $LINES` nanoseconds each"
+done
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Generate the config.h header from a build profile on stdout.
+# Each line of the profile is NAME=y or NAME=n, and lines which are
+# empty or begin with '#' are ignored.
+#
+# Usage: mkconfig.sh profile
+#
+
+if [ $# -ne 1 ]
+then
+	echo "usage: mkconfig.sh profile" >&2
+	exit 1
+fi
+
+if [ ! -r "$1" ]
+then
+	echo "mkconfig.sh: cannot read $1" >&2
+	exit 1
+fi
+
+echo "/*"
+echo " * Generated from $1 by mkconfig.sh.  Do not edit."
+echo " */"
+echo
+echo "#ifndef	CONFIG_H"
+echo "#define	CONFIG_H"
+echo
+
+awk -F= '
+	/^#/ || /^[ \t]*$/	{ next }
+	NF == 2 && $1 ~ /^[A-Z0-9_]+$/ && $2 == "y" \
+				{ printf "#define\t%s\t1\n", $1; next }
+	NF == 2 && $1 ~ /^[A-Z0-9_]+$/ && $2 == "n" \
+				{ printf "#define\t%s\t0\n", $1; next }
+				{ printf "%s:%d: bad line: %s\n", FILENAME, NR, $0 \
+					> "/dev/stderr"; exit 1 }
+' "$1" || exit 1
+
+echo
+echo "#endif"
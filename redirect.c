@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * Input and output redirection for built-in commands and programs.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdio_ext.h>
+
+#include "sash.h"
+
+
+static	char *	getRedirectName(char ** cpPtr);
+
+
+/*
+ * Remove the redirections from a command line and save them in the
+ * specified list.  The recognized forms are "<file", ">file", ">>file",
+ * and "n>&m", where any of them can be preceded by a descriptor number
+ * and the file names can be quoted.  Here documents are left in the
+ * command for the shell.  Returns the original command if there were
+ * no redirections, or else a copy of the command without them in memory
+ * chunks.  Returns NULL with a message output on an error.
+ */
+const char *
+takeRedirects(const char * cmd, RedirectList * list)
+{
+	Redirect *	redirect;
+	char *		newCmd;
+	char *		cp;
+	char *		start;
+	int		quote;
+
+	list->count = 0;
+
+	if (strpbrk(cmd, "<>") == NULL)
+		return cmd;
+
+	newCmd = chunkstrdup(cmd);
+
+	if (newCmd == NULL)
+	{
+		fprintf(stderr, "No memory for command\n");
+
+		return NULL;
+	}
+
+	quote = '\0';
+
+	for (cp = newCmd; *cp; cp++)
+	{
+		if (*cp == '\\')
+		{
+			if (cp[1])
+				cp++;
+
+			continue;
+		}
+
+		if (quote)
+		{
+			if (*cp == quote)
+				quote = '\0';
+
+			continue;
+		}
+
+		if ((*cp == '\'') || (*cp == '"'))
+		{
+			quote = *cp;
+
+			continue;
+		}
+
+		if ((*cp != '<') && (*cp != '>'))
+			continue;
+
+		if ((cp[0] == '<') && (cp[1] == '<'))
+		{
+			cp++;
+
+			continue;
+		}
+
+		if (list->count >= MAX_REDIRECT)
+		{
+			fprintf(stderr, "Too many redirections\n");
+
+			return NULL;
+		}
+
+		redirect = &list->redirects[list->count++];
+
+		/*
+		 * Get the descriptor being redirected, which is either
+		 * the default one or a digit at the start of a word.
+		 */
+		start = cp;
+		redirect->fd = (*cp == '<') ? STDIN : STDOUT;
+
+		if ((cp > newCmd) && isDecimal(cp[-1]) &&
+			((cp - 1 == newCmd) || isBlank(cp[-2])))
+		{
+			start = cp - 1;
+			redirect->fd = cp[-1] - '0';
+		}
+
+		redirect->dupFd = -1;
+		redirect->openFd = -1;
+		redirect->fileName = NULL;
+
+		if (*cp == '<')
+			redirect->flags = O_RDONLY;
+		else if (cp[1] == '>')
+		{
+			redirect->flags = O_WRONLY | O_CREAT | O_APPEND;
+			cp++;
+		}
+		else
+			redirect->flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+		cp++;
+
+		/*
+		 * Get the descriptor being duplicated or else the file name.
+		 */
+		if ((*cp == '&') && isDecimal(cp[1]))
+		{
+			redirect->dupFd = 0;
+			cp++;
+
+			while (isDecimal(*cp))
+				redirect->dupFd = redirect->dupFd * 10 + *cp++ - '0';
+		}
+		else
+		{
+			redirect->fileName = getRedirectName(&cp);
+
+			if (redirect->fileName == NULL)
+				return NULL;
+		}
+
+		/*
+		 * Blank out the redirection from the command.
+		 */
+		while (start < cp)
+			*start++ = ' ';
+
+		cp--;
+	}
+
+	return newCmd;
+}
+
+
+/*
+ * Open the files named in a list of redirections.  The files are opened
+ * close-on-exec so that only the copies made by the redirections are
+ * inherited.  Returns TRUE if successful, or FALSE with a message output
+ * and no files left open on an error.
+ */
+BOOL
+openRedirects(RedirectList * list)
+{
+	Redirect *	redirect;
+	int		i;
+
+	for (i = 0; i < list->count; i++)
+	{
+		redirect = &list->redirects[i];
+
+		if (redirect->fileName == NULL)
+			continue;
+
+		redirect->openFd = openFile(redirect->fileName,
+			redirect->flags | O_CLOEXEC, 0666);
+
+		if (redirect->openFd < 0)
+		{
+			perror(redirect->fileName);
+			closeRedirects(list);
+
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * Close the files opened for a list of redirections.
+ */
+void
+closeRedirects(RedirectList * list)
+{
+	Redirect *	redirect;
+	int		i;
+
+	for (i = 0; i < list->count; i++)
+	{
+		redirect = &list->redirects[i];
+
+		if (redirect->openFd >= 0)
+			close(redirect->openFd);
+
+		redirect->openFd = -1;
+	}
+}
+
+
+/*
+ * Perform a list of opened redirections in this process.  If the saved
+ * descriptor table is not NULL, then the original descriptors are saved
+ * in it so that restoreRedirects can put them back.  The standard I/O
+ * streams are flushed first, and the standard input stream is replaced
+ * if its descriptor is redirected so that buffered input is not lost
+ * or read by the wrong command.  Returns TRUE if successful.
+ */
+BOOL
+applyRedirects(RedirectList * list, int * saved)
+{
+	Redirect *	redirect;
+	FILE *		fp;
+	int		fromFd;
+	int		i;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	list->oldStdin = NULL;
+
+	for (i = 0; i < list->count; i++)
+	{
+		redirect = &list->redirects[i];
+
+		fromFd = redirect->openFd;
+
+		if (redirect->fileName == NULL)
+			fromFd = redirect->dupFd;
+
+		if (saved)
+			saved[i] = fcntl(redirect->fd, F_DUPFD_CLOEXEC, 10);
+
+		if (dup2(fromFd, redirect->fd) < 0)
+		{
+			perror("dup2");
+
+			if (saved)
+				restoreRedirects(list, saved, i + 1);
+
+			return FALSE;
+		}
+
+		if ((redirect->fd != STDIN) || list->oldStdin)
+			continue;
+
+		/*
+		 * Give the command its own standard input stream.
+		 */
+		if (saved == NULL)
+		{
+			__fpurge(stdin);
+
+			continue;
+		}
+
+		fp = fdopen(fcntl(STDIN, F_DUPFD_CLOEXEC, 0), "r");
+
+		if (fp)
+		{
+			list->oldStdin = stdin;
+			stdin = fp;
+		}
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * Undo the first count redirections done by applyRedirects using the
+ * saved descriptor table, in the reverse order that they were done.
+ */
+void
+restoreRedirects(RedirectList * list, int * saved, int count)
+{
+	int	fd;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	if (list->oldStdin)
+	{
+		fclose(stdin);
+		stdin = list->oldStdin;
+		list->oldStdin = NULL;
+	}
+
+	while (count-- > 0)
+	{
+		fd = list->redirects[count].fd;
+
+		if (saved[count] < 0)
+		{
+			close(fd);
+
+			continue;
+		}
+
+		dup2(saved[count], fd);
+		close(saved[count]);
+	}
+}
+
+
+/*
+ * Add the opened redirections in a list to the file actions to be
+ * done when starting a program.
+ */
+void
+addRedirectActions(const RedirectList * list,
+	posix_spawn_file_actions_t * actions)
+{
+	const Redirect *	redirect;
+	int			i;
+
+	for (i = 0; i < list->count; i++)
+	{
+		redirect = &list->redirects[i];
+
+		if (redirect->fileName)
+		{
+			posix_spawn_file_actions_adddup2(actions,
+				redirect->openFd, redirect->fd);
+		}
+		else
+		{
+			posix_spawn_file_actions_adddup2(actions,
+				redirect->dupFd, redirect->fd);
+		}
+	}
+}
+
+
+/*
+ * Collect the file name word of a redirection, removing any quoting.
+ * The word pointer is advanced to the end of the word.  Returns the
+ * name in memory chunks, or NULL with a message output on an error.
+ */
+static char *
+getRedirectName(char ** cpPtr)
+{
+	char *	cp;
+	char *	name;
+	char *	out;
+	int	quote;
+
+	cp = *cpPtr;
+
+	while (isBlank(*cp))
+		cp++;
+
+	name = getChunk(strlen(cp) + 1);
+
+	if (name == NULL)
+	{
+		fprintf(stderr, "No memory for file name\n");
+
+		return NULL;
+	}
+
+	out = name;
+	quote = '\0';
+
+	while (*cp)
+	{
+		if (quote == '\0')
+		{
+			if (isBlank(*cp) || (*cp == '<') || (*cp == '>'))
+				break;
+
+			if ((*cp == '\'') || (*cp == '"'))
+			{
+				quote = *cp++;
+
+				continue;
+			}
+		}
+		else if (*cp == quote)
+		{
+			quote = '\0';
+			cp++;
+
+			continue;
+		}
+
+		if ((*cp == '\\') && cp[1])
+			cp++;
+
+		*out++ = *cp++;
+	}
+
+	*out = '\0';
+
+	if (quote)
+	{
+		fprintf(stderr, "Unmatched quote character\n");
+
+		return NULL;
+	}
+
+	if (*name == '\0')
+	{
+		fprintf(stderr, "Missing file name for redirection\n");
+
+		return NULL;
+	}
+
+	*cpPtr = cp;
+
+	return name;
+}
+
+/* END CODE */
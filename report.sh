@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Report the size and startup time of the sash binary which was built
+# for a profile.  The startup time is the average over many runs of a
+# command which does nothing.
+#
+# Usage: report.sh profile
+#
+
+RUNS=200
+
+if [ ! -x ./sash ]
+then
+	echo "report.sh: sash has not been built" >&2
+	exit 1
+fi
+
+bytes=`wc -c < ./sash`
+commands=`./sash -c help | wc -l`
+
+start=`date +%s%N`
+i=0
+
+while [ $i -lt $RUNS ]
+do
+	./sash -c exit
+	i=`expr $i + 1`
+done
+
+end=`date +%s%N`
+
+echo "$1: $commands commands, $bytes bytes"
+size ./sash | sed 1d | awk '{ printf "    text %d, data %d, bss %d\n", $1, $2, $3 }'
+echo "    startup `expr \( $end - $start \) / $RUNS / 1000` microseconds"
@@ -7,10 +7,17 @@
  * This program should NOT be built using shared libraries.
  */
 
+#define	_GNU_SOURCE
+
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <signal.h>
+#include <limits.h>
 #include <errno.h>
+#include <spawn.h>
+#include <stdio_ext.h>
 
 #include "sash.h"
 
@@ -25,13 +32,23 @@ static const char * const	version = "3.4-fmb";
 #define	INFINITE_ARGS	0x7fffffff
 
 
+/*
+ * The sizes of the memory set aside for the emergency mode.
+ * The heap reserve is kept by malloc after being freed, so that all
+ * later allocations by the built-in commands are satisfied from it.
+ */
+#define	HEAP_RESERVE_SIZE	(8 * 1024 * 1024)
+#define	CHUNK_RESERVE_SIZE	(1024 * 1024)
+#define	STACK_RESERVE_SIZE	(256 * 1024)
+
+
 /*
  * One entry of the command table.
  */
 typedef struct
 {
 	const char *	name;
-	void		(*func)(int argc, const char ** argv);
+	int		(*func)(int argc, const char ** argv);
 	int		minArgs;
 	int		maxArgs;
 	const char *	description;
@@ -57,11 +74,13 @@ static const CommandEntry	commandEntryTable[] =
 		""
 	},
 
+#if	CMD_AR
 	{
 		"-ar",		do_ar,		3,	INFINITE_ARGS,
 		"Extract or list files from an AR file",
 		"[txp]v arFileName fileName ..."
 	},
+#endif
 
 	{
 		"cd",		do_cd,		1,	2,
@@ -69,7 +88,7 @@ static const CommandEntry	commandEntryTable[] =
 		"[dirName]"
 	},
 
-#ifdef	HAVE_EXT2
+#if	defined(HAVE_EXT2) && CMD_CHATTR
 	{
 		"-chattr",	do_chattr,	3,	INFINITE_ARGS,
 		"Change ext2 file attributes",
@@ -77,37 +96,47 @@ static const CommandEntry	commandEntryTable[] =
 	},
 #endif
 
+#if	CMD_CHGRP
 	{
 		"-chgrp",	do_chgrp,	3,	INFINITE_ARGS,
 		"Change the group id of some files",
 		"gid fileName ..."
 	},
+#endif
 
+#if	CMD_CHMOD
 	{
 		"-chmod",	do_chmod,	3,	INFINITE_ARGS,
 		"Change the protection of some files",
 		"mode fileName ..."
 	},
+#endif
 
+#if	CMD_CHOWN
 	{
 		"-chown",	do_chown,	3,	INFINITE_ARGS,
 		"Change the owner id of some files",
 		"uid fileName ..."
 	},
+#endif
 
+#if	CMD_CMP
 	{
 		"-cmp",		do_cmp,		3,	3,
 		"Compare two files for equality",
 		"fileName1 fileName2"
 	},
+#endif
 
+#if	CMD_CP
 	{
 		"-cp",		do_cp,		3,	INFINITE_ARGS,
 		"Copy files",
 		"srcName ... destName"
 	},
+#endif
 
-#ifdef	HAVE_LINUX_CHROOT
+#if	defined(HAVE_LINUX_CHROOT) && CMD_CHROOT
 	{
 		"-chroot",	do_chroot,	2,	2,
 		"change root file system",
@@ -115,23 +144,29 @@ static const CommandEntry	commandEntryTable[] =
 	},
 #endif
 
+#if	CMD_DD
 	{
 		"-dd",		do_dd,		3,	INFINITE_ARGS,
 		"Copy data between two files",
 		"if=name of=name [bs=n] [count=n] [skip=n] [seek=n]"
 	},
+#endif
 
+#if	CMD_ECHO
 	{
 		"-echo",	do_echo,	1,	INFINITE_ARGS,
 		"Echo the arguments",
 		"[args] ..."
 	},
+#endif
 
+#if	CMD_ED
 	{
 		"-ed",		do_ed,		1,	2,
 		"Edit a fileName using simple line mode commands",
 		"[fileName]"
 	},
+#endif
 
 	{
 		"exec",		do_exec,	2,	INFINITE_ARGS,
@@ -140,30 +175,36 @@ static const CommandEntry	commandEntryTable[] =
 	},
 
 	{
-		"exit",		do_exit,	1,	1,
+		"exit",		do_exit,	1,	2,
 		"Exit from sash",
-		""
+		"[status]"
 	},
 
+#if	CMD_FILE
 	{
 		"-file",	do_file,	1,	INFINITE_ARGS,
 		"Describe information about files",
 		"fileName ..."
 	},
+#endif
 
+#if	CMD_FIND
 	{
 		"-find",	do_find,	2,	INFINITE_ARGS,
 		"Find files in a directory tree meeting some conditions",
 		"dirName [-xdev] [-type chars] [-name pattern] [-size minSize]"
 	},
+#endif
 
+#if	CMD_GREP
 	{
-		"-grep",	do_grep,	3,	INFINITE_ARGS,
+		"-grep",	do_grep,	2,	INFINITE_ARGS,
 		"Look for lines containing a word in some files",
-		"[-in] word fileName ..."
+		"[-in] word [fileName ...]"
 	},
+#endif
 
-#ifdef	HAVE_GZIP
+#if	defined(HAVE_GZIP) && CMD_GZIP
 	{
 		"-gunzip",	do_gunzip,	2,	INFINITE_ARGS,
 		"Uncompress files which were saved in GZIP or compress format",
@@ -177,19 +218,33 @@ static const CommandEntry	commandEntryTable[] =
 	},
 #endif
 
+	{
+		"hash",		do_hash,	1,	INFINITE_ARGS,
+		"Remember or list the full paths of programs",
+		"[-r] [programName ...]"
+	},
+
 	{
 		"help",		do_help,	1,	2,
 		"Print help about a command",
 		"[word]"
 	},
 
+	{
+		"jobs",		do_jobs,	1,	1,
+		"List the commands running in the background",
+		""
+	},
+
+#if	CMD_KILL
 	{
 		"-kill",	do_kill,	2,	INFINITE_ARGS,
 		"Send a signal to the specified process",
 		"[-sig] pid ..."
 	},
+#endif
 
-#ifdef	HAVE_LINUX_LOSETUP
+#if	defined(HAVE_LINUX_LOSETUP) && CMD_LOSETUP
 	{
 		"-losetup",	do_losetup,	3,	3,
 		"Associate a loopback device with a file",
@@ -197,19 +252,23 @@ static const CommandEntry	commandEntryTable[] =
 	},
 #endif
 
+#if	CMD_LN
 	{
 		"-ln",		do_ln,		3,	INFINITE_ARGS,
 		"Link one fileName to another",
 		"[-s] srcName ... destName"
 	},
+#endif
 
+#if	CMD_LS
 	{
 		"-ls",		do_ls,		1,	INFINITE_ARGS,
 		"List information about files or directories",
 		"[-lidFC] fileName ..."
 	},
+#endif
 
-#ifdef	HAVE_EXT2
+#if	defined(HAVE_EXT2) && CMD_CHATTR
 	{
 		"-lsattr",	do_lsattr,	2,	INFINITE_ARGS,
 		"List ext2 file attributes",
@@ -217,37 +276,63 @@ static const CommandEntry	commandEntryTable[] =
 	},
 #endif
 
+#if	CMD_MKDIR
 	{
 		"-mkdir",	do_mkdir,	2,	INFINITE_ARGS,
 		"Create a directory",
 		"dirName ..."
 	},
+#endif
 
+#if	CMD_MKNOD
 	{
 		"-mknod",	do_mknod,	5,	5,
 		"Create a special type of file",
 		"fileName type major minor"
 	},
+#endif
 
+#if	CMD_MORE
 	{
 		"-more",	do_more,	2,	INFINITE_ARGS,
 		"Type file contents page by page",
 		"fileName ..."
 	},
+#endif
 
+#if	CMD_MOUNT
 	{
 		"-mount",	do_mount,	3,	INFINITE_ARGS,
 		"Mount or remount a filesystem on a directory",
 		"[-t type] [-r] [-m] devName dirName"
 	},
+#endif
 
+#if	CMD_MV
 	{
 		"-mv",		do_mv,		3,	INFINITE_ARGS,
 		"Move or rename files",
 		"srcName ... destName"
 	},
+#endif
+
+#if	CMD_PARALLEL
+	{
+		"-parallel",	do_parallel,	2,	INFINITE_ARGS,
+		"Run a command for each of some items, several at once",
+		"[-j jobs] command [args ...] [::: item ...]"
+	},
+#endif
+
+#if	CMD_PERF
+	{
+		"-perf",	do_perf,	2,	INFINITE_ARGS,
+		"Run a command and show its processor performance counters",
+		"command [args ...]"
+	},
+#endif
 
-#ifdef	HAVE_LINUX_PIVOT
+#if	defined(HAVE_LINUX_PIVOT) && CMD_PIVOT_ROOT
 	{
 		"-pivot_root",	do_pivot_root,	3,	3,
 		"pivot the root file system",
@@ -255,11 +340,13 @@ static const CommandEntry	commandEntryTable[] =
 	},
 #endif
 
+#if	CMD_PRINTENV
 	{
 		"-printenv",	do_printenv,	1,	2,
 		"Print environment variables",
 		"[name]"
 	},
+#endif
 
 	{
 		"prompt",	do_prompt,	2,	INFINITE_ARGS,
@@ -267,11 +354,13 @@ static const CommandEntry	commandEntryTable[] =
 		"string"
 	},
 
+#if	CMD_PWD
 	{
 		"-pwd",		do_pwd,		1,	1,
 		"Print the current working directory",
 		""
 	},
+#endif
 
 	{
 		"quit",		do_exit,	1,	1,
@@ -279,17 +368,21 @@ static const CommandEntry	commandEntryTable[] =
 		""
 	},
 
+#if	CMD_RM
 	{
 		"-rm",		do_rm,		2,	INFINITE_ARGS,
 		"Remove the specified files",
 		"fileName ..."
 	},
+#endif
 
+#if	CMD_RMDIR
 	{
 		"-rmdir",	do_rmdir,	2,	INFINITE_ARGS,
 		"Remove the specified empty directories",
 		"dirName ..."
 	},
+#endif
 
 	{
 		"setenv",	do_setenv,	3,	3,
@@ -303,29 +396,51 @@ static const CommandEntry	commandEntryTable[] =
 		"fileName"
 	},
 
+#if	CMD_STATS
+	{
+		"-stats",	do_stats,	1,	2,
+		"Show or reset the performance counters of the commands",
+		"[reset]"
+	},
+#endif
+
+#if	CMD_SUM
 	{
 		"-sum",		do_sum,		2,	INFINITE_ARGS,
 		"Calculate checksums of the specified files",
 		"fileName ..."
 	},
+#endif
 
+#if	CMD_SYNC
 	{
 		"-sync",	do_sync,	1,	1,
 		"Sync the disks to force cached data to them",
 		""
 	},
+#endif
 
+#if	CMD_TAR
 	{
 		"-tar",		do_tar,		2,	INFINITE_ARGS,
 		"Create, extract, or list files from a TAR file",
 		"[cxtv]f tarFileName fileName ..."
 	},
+#endif
 
+#if	CMD_TOUCH
 	{
 		"-touch",	do_touch,	2,	INFINITE_ARGS,
 		"Update times or create the specified files",
 		"fileName ..."
 	},
+#endif
+
+	{
+		"trace",	do_trace,	2,	3,
+		"Turn tracing of the commands which are run on or off",
+		"on|off [fd | fileName]"
+	},
 
 	{
 		"umask",	do_umask,	1,	2,
@@ -333,11 +448,13 @@ static const CommandEntry	commandEntryTable[] =
 		"[mask]"
 	},
 
+#if	CMD_MOUNT
 	{
 		"-umount",	do_umount,	2,	2,
 		"Unmount a filesystem",
 		"fileName"
 	},
+#endif
 
 	{
 		"unalias",	do_unalias,	2,	2,
@@ -345,11 +462,19 @@ static const CommandEntry	commandEntryTable[] =
 		"name"
 	},
 
+	{
+		"wait",		do_wait,	1,	INFINITE_ARGS,
+		"Wait for commands running in the background to finish",
+		"[[%]jobId ...]"
+	},
+
+#if	CMD_WHERE
 	{
 		"-where",	do_where,	2,	2,
 		"Type the location of a program",
 		"program"
 	},
+#endif
 
 	{
 		NULL,		0,		0,	0,
@@ -359,28 +484,175 @@ static const CommandEntry	commandEntryTable[] =
 };
 
 
+/*
+ * Index of the command table sorted by name, so that the built-in
+ * commands can be found using a binary search.  This is built on
+ * first use, since the table itself is kept in the order that the
+ * help command displays it.
+ */
+static	const CommandEntry *	commandIndex[sizeof(commandEntryTable) /
+	sizeof(commandEntryTable[0])];
+
+static	int	commandIndexCount;
+
+
+/*
+ * The performance counters of each of the built-in commands, which
+ * are found on first use, and of the external programs.
+ */
+static	Stats *	commandStats[sizeof(commandEntryTable) /
+	sizeof(commandEntryTable[0])];
+
+static	Stats *	programStats;
+
+
+/*
+ * The built-in commands which only use the standard I/O streams for
+ * their input and output, and so can be run within this process as
+ * stages of a pipeline.  Those which keep state in static variables
+ * are not reentrant and cannot be used twice in the same pipeline.
+ */
+typedef struct
+{
+	const char *	name;
+	BOOL		reentrant;
+} StreamCommand;
+
+
+static const StreamCommand	streamCommandTable[] =
+{
+	{"-echo",	TRUE},
+	{"-file",	FALSE},
+	{"-find",	FALSE},
+	{"-grep",	TRUE},
+	{"help",	TRUE},
+	{"-ls",		FALSE},
+	{"-printenv",	TRUE},
+	{"-pwd",	TRUE},
+	{"-sum",	TRUE},
+	{"-where",	FALSE},
+	{NULL,		FALSE}
+};
+
+
 /*
  * The definition of an command alias.
+ * The name and value strings are stored in the alias arena, and are
+ * referred to by their offsets since the arena can move when it grows.
  */
 typedef struct
 {
-	char *	name;
-	char *	value;
+	int	name;
+	int	value;
 } Alias;
 
 
+#define	ALIAS_HASH_INIT	64
+#define	ALIAS_ARENA_INIT	1024
+
+#define	aliasString(offset)	(aliasArena + (offset))
+
+
 /*
  * Local data.
  */
 static	Alias *	aliasTable;
 static	int	aliasCount;
 
+/*
+ * Open addressing hash table for finding aliases by name.
+ * Each slot contains one more than the index of the alias in aliasTable,
+ * or zero if the slot is empty.  The table size is a power of two and is
+ * kept at most half full.
+ */
+static	int *	aliasHash;
+static	int	aliasHashSize;
+
+/*
+ * Arena holding the alias strings.  Strings of removed or redefined
+ * aliases are counted as garbage and reclaimed when the arena is full.
+ */
+static	char *	aliasArena;
+static	int	aliasArenaUsed;
+static	int	aliasArenaSize;
+static	int	aliasArenaGarbage;
+
+/*
+ * Count of the times that a new alias name has been defined.
+ * This tells when a script line which was parsed as a built-in
+ * command has to be checked again in case it is now an alias.
+ */
+static	int	aliasGeneration;
+
+/*
+ * The buffer used for expanding variables in commands.
+ */
+static	char *	expandBuffer;
+static	int	expandSize;
+static	int	expandUsed;
+
+
+/*
+ * One command line of a script file or of a control statement.
+ * Simple built-in commands are parsed when the line is first run, and
+ * the built-in function is then called directly each time that the line
+ * is run.  Otherwise the line is run as if it had just been read.
+ */
+struct	scriptLine
+{
+	const char *		text;
+	const CommandEntry *	entry;
+	int			argc;
+	const char **		argv;
+	int			aliasGeneration;
+};
+
+
+/*
+ * A script file which has been read and parsed.  Scripts are kept in
+ * memory so that sourcing an unchanged file again does not read or
+ * parse it again.  A script is identified by its name and its file's
+ * identity, size and modification time.  Nothing is saved on disk, so
+ * the first source of a file in each process costs as much as before.
+ */
+typedef	struct	script	SCRIPT;
+
+struct	script
+{
+	SCRIPT *	next;
+	char *		name;
+	dev_t		dev;
+	ino_t		ino;
+	off_t		size;
+	time_t		mtime;
+	long		mtimeNsec;
+	char *		data;
+	ScriptLine *	lines;
+	int		lineCount;
+	int		useCount;
+	BOOL		stale;
+};
+
+
+static	SCRIPT *	scriptList;
+
 static	FILE *	sourcefiles[MAX_SOURCE];
 static	int	sourceCount;
 
 static	BOOL	intCrlf = TRUE;
 static	char *	prompt;
 
+/*
+ * Whether pipelines of built-in commands may be run within the shell.
+ * The -P option turns this off so that they always use processes.
+ */
+static	BOOL	streamFlag = TRUE;
+
+/*
+ * The exit status of the last command.
+ */
+int	lastStatus;
+
 
 /*
  * Local procedures.
@@ -388,14 +660,57 @@ static	char *	prompt;
 static	void	catchInt(int);
 static	void	catchQuit(int);
 static	void	readFile(const char * name);
-static	void	command(const char * cmd);
-static	BOOL	tryBuiltIn(const char * cmd);
-static	void	runCmd(const char * cmd);
-static	void	childProcess(const char * cmd);
+static	SCRIPT *	loadScript(const char * name, int fd,
+			const struct stat * statBuf);
+static	BOOL	splitScript(SCRIPT * script);
+static	void	prepareScriptLine(ScriptLine * line);
+static	void	freeScript(SCRIPT * script);
+static	BOOL	tryBuiltIn(const char * cmd, int * statusPtr);
+static	BOOL	parseBuiltIn(const CommandEntry * entry, const char * cmd,
+			int * argcPtr, const char *** argvPtr);
+static	const char *	expandCommand(const char * cmd);
+static	BOOL	appendExpansion(const char * str, int len);
+static	const char *	findVariable(const char * name, int len);
+static	const char *	substituteCommand(const char * cmd);
+static	char *	captureCommand(const char * cmd);
+static	char *	readCapture(int fd);
+static	char *	copyCapture(const char * buf, int len);
+static	const char *	findUnquoted(const char * cmd, const char * chars);
+static	BOOL	hasOperators(const char * cmd);
+static	BOOL	isPipeline(const char * cmd);
+static	const char *	takeBackground(const char * cmd);
+static	void	runCommand(const char * cmd, Trace * trace);
+static	int	runBuiltIn(const char * cmd, RedirectList * list);
+static	int	callBuiltIn(const CommandEntry * entry, int argc,
+	const char ** argv);
+static	int	runCmd(const char * cmd, const char * simpleCmd,
+			RedirectList * list);
+static	int	runShell(const char * cmd);
+static	BOOL	hasMagic(const char * cmd);
+static	int	waitChild(pid_t pid);
+static	int	runPipeline(const char * cmd, BOOL background);
+static	const char **	splitPipeline(const char * cmd, int * countPtr);
+static	int	runStages(const char * jobCmd, const char ** stages,
+	int stageCount, BOOL background);
+static	int	runStreams(const char ** cmds, int count);
+static	pid_t	runStage(const char * cmd, int inFd, int outFd, pid_t pgrp);
+static	pid_t	spawnProgram(const char ** argv,
+			const posix_spawn_file_actions_t * actions,
+			const posix_spawnattr_t * attrs);
 static	void	showPrompt(void);
 static	void	usage(void);
-static	Alias *	findAlias(const char * name);
-static	void	expandVariable(char * name);
+static	void	reserveMemory(void);
+static	int	touchStack(void);
+static	BOOL	runCalledAs(int argc, const char ** argv, int * statusPtr);
+static	Alias *	findAlias(const char * name, int len);
+static	int	findAliasSlot(const char * name, int len);
+static	void	removeAliasSlot(int slot);
+static	BOOL	growAliasHash(void);
+static	BOOL	reserveAliasArena(int len);
+static	int	addAliasString(const char * str);
+static	const CommandEntry *	findCommand(const char * name, int len);
+static	int	commandSort(const void * p1, const void * p2);
+static	int	nameCompare(const char * name, int len, const char * entryName);
 
 
 /*
@@ -409,13 +724,29 @@ main(int argc, const char ** argv)
 {
 	const char *	cp;
 	const char *	singleCommand;
+	const char *	serverPath;
+	const char *	clientPath;
 	BOOL		quietFlag;
 	BOOL		aliasFlag;
+	BOOL		reserveFlag;
+	BOOL		traceFlag;
+	int		status;
 	char		buf[PATH_LEN];
 
 	singleCommand = NULL;
+	serverPath = NULL;
+	clientPath = NULL;
 	quietFlag = FALSE;
 	aliasFlag = FALSE;
+	reserveFlag = FALSE;
+	traceFlag = FALSE;
+
+	/*
+	 * If we were run using the name of a built-in command, such as
+	 * through a symbolic link, then just run that command.
+	 */
+	if (runCalledAs(argc, argv, &status))
+		return status;
 
 	/*
 	 * Look for options.
@@ -442,6 +773,32 @@ main(int argc, const char ** argv)
 
 				break;
 
+			case 'S':
+				/*
+				 * Run as a command server on a socket.
+				 */
+				if ((argc != 1) || serverPath)
+					usage();
+
+				serverPath = *argv++;
+				argc--;
+
+				break;
+
+			case 'C':
+				/*
+				 * Execute the specified command using
+				 * a command server.
+				 */
+				if ((argc != 2) || clientPath)
+					usage();
+
+				clientPath = *argv++;
+				singleCommand = *argv++;
+				argc -= 2;
+
+				break;
+
 			case 'p':
 				/*
 				 * Set the prompt string.
@@ -465,6 +822,18 @@ main(int argc, const char ** argv)
 				aliasFlag = TRUE;
 				break;
 
+			case 'm':
+				reserveFlag = TRUE;
+				break;
+
+			case 'x':
+				traceFlag = TRUE;
+				break;
+
+			case 'P':
+				streamFlag = FALSE;
+				break;
+
 			case 'h':
 			case '?':
 				usage();
@@ -477,6 +846,31 @@ main(int argc, const char ** argv)
 		}
 	}
 
+	/*
+	 * A client of a command server needs nothing else set up.
+	 */
+	if (clientPath)
+		return runClient(clientPath, singleCommand);
+
+	/*
+	 * Set aside and lock down our memory if we are to keep working
+	 * when the system runs out of it.
+	 */
+	if (reserveFlag)
+		reserveMemory();
+
+	/*
+	 * Trace the commands to our stderr if we are told to.
+	 */
+	if (traceFlag)
+		traceTo(STDERR);
+
+	/*
+	 * Reap background jobs and the commands run by other built-in
+	 * commands however we are running commands.
+	 */
+	initJobs();
+
 	/*
 	 * No more arguments are allowed.
 	 */
@@ -499,14 +893,22 @@ main(int argc, const char ** argv)
 	if (aliasFlag)
 		do_aliasall(0, NULL);
 
+	/*
+	 * If we are to be a command server, then do that until we are
+	 * stopped.
+	 */
+	if (serverPath)
+		return runServer(serverPath);
+
 	/*
 	 * If we are to execute a single command, then do so and exit.
 	 */
 	if (singleCommand)
 	{
 		command(singleCommand);
+		endControl(TRUE);
 
-		return 0;
+		return lastStatus;
 	}
 
 	/*
@@ -554,14 +956,20 @@ main(int argc, const char ** argv)
 static void
 readFile(const char * name)
 {
-	FILE *	fp;
-	int	cc;
-	BOOL	ttyFlag;
-	char	buf[CMD_LEN];
+	FILE *		fp;
+	SCRIPT *	script;
+	struct stat	statBuf;
+	char *		buf;
+	size_t		bufSize;
+	ssize_t		cc;
+	int		fd;
+	int		i;
+	BOOL		ttyFlag;
 
 	if (sourceCount >= MAX_SOURCE)
 	{
 		fprintf(stderr, "Too many source files\n");
+		lastStatus = 1;
 
 		return;
 	}
@@ -570,11 +978,54 @@ readFile(const char * name)
 
 	if (name)
 	{
-		fp = fopen(name, "r");
+		fd = openFile(name, O_RDONLY | O_CLOEXEC, 0);
+
+		if ((fd < 0) || (fstat(fd, &statBuf) < 0))
+		{
+			perror(name);
+			lastStatus = 1;
+
+			if (fd >= 0)
+				close(fd);
+
+			return;
+		}
+
+		/*
+		 * Regular files are run from their parsed copies in memory.
+		 */
+		if (S_ISREG(statBuf.st_mode))
+		{
+			script = loadScript(name, fd, &statBuf);
+
+			close(fd);
+
+			if (script == NULL)
+				return;
+
+			sourcefiles[sourceCount++] = NULL;
+			script->useCount++;
+
+			for (i = 0; (i < script->lineCount) && !intFlag; i++)
+				runScriptLine(&script->lines[i]);
+
+			endControl(!intFlag);
+
+			script->useCount--;
+			sourceCount--;
+
+			if (script->stale && (script->useCount == 0))
+				freeScript(script);
+
+			return;
+		}
+
+		fp = fdopen(fd, "r");
 
 		if (fp == NULL)
 		{
 			perror(name);
+			close(fd);
 
 			return;
 		}
@@ -584,20 +1035,37 @@ readFile(const char * name)
 
 	ttyFlag = isatty(fileno(fp));
 
+	/*
+	 * The line buffer grows as needed to hold the longest line.
+	 * It belongs to this call since the commands can source other files.
+	 */
+	buf = NULL;
+	bufSize = 0;
+
 	while (TRUE)
 	{
 		if (ttyFlag)
+		{
+			if (intFlag)
+				endControl(FALSE);
+
+			reportJobs();
 			showPrompt();
+		}
 
 		if (intFlag && !ttyFlag && (fp != stdin))
 		{
+			endControl(FALSE);
 			fclose(fp);
+			free(buf);
 			sourceCount--;
 
 			return;
 		}
 	
-		if (fgets(buf, CMD_LEN - 1, fp) == NULL)
+		cc = getline(&buf, &bufSize, fp);
+
+		if (cc < 0)
 		{
 			if (ferror(fp) && (errno == EINTR))
 			{
@@ -609,9 +1077,7 @@ readFile(const char * name)
 			break;
 		}
 
-		cc = strlen(buf);
-
-		if (buf[cc - 1] == '\n')
+		if ((cc > 0) && (buf[cc - 1] == '\n'))
 			cc--;
 
 		while ((cc > 0) && isBlank(buf[cc - 1]))
@@ -635,674 +1101,3069 @@ readFile(const char * name)
 	if (fp != stdin)
 		fclose(fp);
 
+	endControl(TRUE);
+	free(buf);
 	sourceCount--;
 }
 
 
 /*
- * Parse and execute one null-terminated command line string.
- * This breaks the command line up into words, checks to see if the
- * command is an alias, and expands wildcards.
+ * Return the parsed copy of a script file which is open on the specified
+ * file descriptor, reading and parsing it if it is not in memory or if
+ * the file has changed since it was read.  Returns NULL with a message
+ * output on an error.
  */
-static void
-command(const char * cmd)
+static SCRIPT *
+loadScript(const char * name, int fd, const struct stat * statBuf)
 {
-	const char *	endCmd;
-	const Alias *	alias;
-	char		newCommand[CMD_LEN];
-	char		cmdName[CMD_LEN];
-
-	/*
-	 * Rest the interrupt flag and free any memory chunks that
-	 * were allocated by the previous command.
-	 */
-	intFlag = FALSE;
+	SCRIPT *	script;
+	SCRIPT **	link;
+	char *		newData;
+	int		size;
+	int		used;
+	int		cc;
+
+	for (link = &scriptList; (script = *link) != NULL; link = &script->next)
+	{
+		if (strcmp(script->name, name) == 0)
+			break;
+	}
 
-	freeChunks();
+	if (script)
+	{
+		if ((script->dev == statBuf->st_dev) &&
+			(script->ino == statBuf->st_ino) &&
+			(script->size == statBuf->st_size) &&
+			(script->mtime == statBuf->st_mtim.tv_sec) &&
+			(script->mtimeNsec == statBuf->st_mtim.tv_nsec))
+		{
+			return script;
+		}
 
-	/*
-	 * Skip leading blanks.
-	 */
-	while (isBlank(*cmd))
-		cmd++;
+		/*
+		 * The file has changed, so forget the old copy, but not
+		 * until it is finished being run if it is in use.
+		 */
+		*link = script->next;
+		script->stale = TRUE;
 
-	/*
-	 * If the command is empty or is a comment then ignore it.
-	 */
-	if ((*cmd == '\0') || (*cmd == '#'))
-		return;
+		if (script->useCount == 0)
+			freeScript(script);
+	}
 
-	/*
-	 * Look for the end of the command name and then copy the
-	 * command name to a buffer so we can null terminate it.
-	 */
-	endCmd = cmd;
+	script = (SCRIPT *) calloc(1, sizeof(SCRIPT));
 
-	while (*endCmd && !isBlank(*endCmd))
-		endCmd++;
+	if (script == NULL)
+	{
+		fprintf(stderr, "No memory for script\n");
 
-	memcpy(cmdName, cmd, endCmd - cmd);
+		return NULL;
+	}
 
-	cmdName[endCmd - cmd] = '\0';
+	script->name = strdup(name);
+	script->dev = statBuf->st_dev;
+	script->ino = statBuf->st_ino;
+	script->size = statBuf->st_size;
+	script->mtime = statBuf->st_mtim.tv_sec;
+	script->mtimeNsec = statBuf->st_mtim.tv_nsec;
 
 	/*
-	 * Search for the command name in the alias table.
-	 * If it is found, then replace the command name with
-	 * the alias value, and append the current command
-	 * line arguments to that.
+	 * Read the whole file, allowing for it to grow while being read.
 	 */
-	alias = findAlias(cmdName);
+	size = statBuf->st_size + 1;
+	used = 0;
+	script->data = malloc(size);
 
-	if (alias)
+	while (script->name && script->data)
 	{
-		strcpy(newCommand, alias->value);
-		strcat(newCommand, endCmd);
+		cc = read(fd, script->data + used, size - used - 1);
 
-		cmd = newCommand;
-	}
+		if ((cc < 0) && (errno == EINTR))
+			continue;
 
-	/*
-	 * Expand simple environment variables
-	 */
-	while (strstr(cmd, "$(")) expandVariable((char *)cmd);
+		if (cc < 0)
+		{
+			perror(name);
+			freeScript(script);
 
-	/*
-	 * Now look for the command in the builtin table, and execute
-	 * the command if found.
-	 */
-	if (tryBuiltIn(cmd))
-		return;
+			return NULL;
+		}
 
-	/*
-	 * The command is not a built-in, so run the program along
-	 * the PATH list.
-	 */
-	runCmd(cmd);
-}
+		if (cc == 0)
+			break;
 
+		used += cc;
 
-/*
- * Try to execute a built-in command.
- * Returns TRUE if the command is a built in, whether or not the
- * command succeeds.  Returns FALSE if this is not a built-in command.
+		if (used < size - 1)
+			continue;
+
+		size += BUF_SIZE;
+		newData = realloc(script->data, size);
+
+		if (newData == NULL)
+		{
+			free(script->data);
+			script->data = NULL;
+
+			break;
+		}
+
+		script->data = newData;
+	}
+
+	if ((script->name == NULL) || (script->data == NULL))
+	{
+		fprintf(stderr, "No memory for script\n");
+		freeScript(script);
+
+		return NULL;
+	}
+
+	script->data[used] = '\0';
+
+	if (!splitScript(script))
+	{
+		fprintf(stderr, "No memory for script\n");
+		freeScript(script);
+
+		return NULL;
+	}
+
+	script->next = scriptList;
+	scriptList = script;
+
+	return script;
+}
+
+
+/*
+ * Split the data of a script into its command lines.  Lines are trimmed
+ * the same way as when reading commands, and are copied into a new
+ * buffer as null terminated strings.  Empty lines and comments are
+ * dropped.  Returns FALSE if there is no memory.
  */
 static BOOL
-tryBuiltIn(const char * cmd)
+splitScript(SCRIPT * script)
 {
-	const char *		endCmd;
-	const CommandEntry *	entry;
-	int			argc;
-	const char **		argv;
-	char			cmdName[CMD_LEN];
-
-	/*
-	 * Look for the end of the command name and then copy the
-	 * command name to a buffer so we can null terminate it.
-	 */
-	endCmd = cmd;
+	ScriptLine *	line;
+	const char *	cp;
+	const char *	end;
+	const char *	next;
+	char *		text;
+	char *		textEnd;
+	int		maxLines;
+	int		len;
 
-	while (*endCmd && !isBlank(*endCmd))
-		endCmd++;
+	len = strlen(script->data);
+	maxLines = 1;
 
-	memcpy(cmdName, cmd, endCmd - cmd);
+	for (cp = script->data; *cp; cp++)
+	{
+		if (*cp == '\n')
+			maxLines++;
+	}
 
-	cmdName[endCmd - cmd] = '\0';
+	script->lines = (ScriptLine *) malloc(sizeof(ScriptLine) * maxLines);
+	text = malloc(len + maxLines);
 
-	/*
-	 * Search the command table looking for the command name.
-	 */
-	for (entry = commandEntryTable; entry->name != NULL; entry++)
+	if ((script->lines == NULL) || (text == NULL))
 	{
-		if (strcmp(entry->name, cmdName) == 0)
-			break;
-	}
+		free(text);
 
-	/*
-	 * If the command is not a built-in, return indicating that.
-	 */
-	if (entry->name == NULL)
 		return FALSE;
+	}
 
-	/*
-	 * The command is a built-in.
-	 * Break the command up into arguments and expand wildcards.
-	 */
-	if (!makeArgs(cmd, &argc, &argv))
-		return TRUE;
+	textEnd = text;
 
-	/*
-	 * Give a usage string if the number of arguments is too large
-	 * or too small.
-	 */
-	if ((argc < entry->minArgs) || (argc > entry->maxArgs))
+	for (cp = script->data; *cp; cp = next)
 	{
-		fprintf(stderr, "usage: %s %s\n", entry->name, entry->usage);
+		/*
+		 * Find the end of the line.
+		 */
+		end = strchr(cp, '\n');
 
-		return TRUE;
+		if (end == NULL)
+			end = cp + strlen(cp);
+
+		next = end;
+
+		if (*end == '\n')
+			next++;
+
+		while ((end > cp) && isBlank(end[-1]))
+			end--;
+
+		while ((cp < end) && isBlank(*cp))
+			cp++;
+
+		if ((cp == end) || (*cp == '#'))
+			continue;
+
+		line = &script->lines[script->lineCount++];
+
+		memcpy(textEnd, cp, end - cp);
+		textEnd[end - cp] = '\0';
+
+		line->text = textEnd;
+		line->entry = NULL;
+		line->argv = NULL;
+		line->aliasGeneration = -1;
+
+		textEnd += end - cp + 1;
 	}
 
-	/*
-	 * Call the built-in function with the argument list.
-	 */
-	entry->func(argc, argv);
+	free(script->data);
+	script->data = text;
 
 	return TRUE;
 }
 
 
 /*
- * Execute the specified command either by forking and executing
- * the program ourself, or else by using the shell.
+ * Parse a script line now if it is a simple built-in command which will
+ * always be run the same way.  That means that its command name is not
+ * an alias, its usage is correct, and it has no variables, wildcards,
+ * redirections, or other shell operators.
  */
 static void
-runCmd(const char * cmd)
+prepareScriptLine(ScriptLine * line)
 {
-	const char *	cp;
-	BOOL		magic;
-	pid_t		pid;
-	int		status;
+	const CommandEntry *	entry;
+	const char *		cp;
+	const char **		argv;
+	int			argc;
+	int			len;
+	int			quote;
+
+	free((char *) line->argv);
+
+	line->entry = NULL;
+	line->argc = 0;
+	line->argv = NULL;
+	line->aliasGeneration = aliasGeneration;
+
+	/*
+	 * Variables and command substitutions are expanded even within
+	 * double quotes.
+	 */
+	if ((findUnquoted(line->text, "|&;<>*?[") != NULL) ||
+		(strpbrk(line->text, "$`") != NULL))
+	{
+		return;
+	}
 
 	/*
-	 * Check the command for any magic shell characters
-	 * except for quoting.
+	 * Make sure that the quoting is correct so that errors from
+	 * parsing the line are only output when the line is run.
 	 */
-	magic = FALSE;
+	quote = '\0';
 
-	for (cp = cmd; *cp; cp++)
+	for (cp = line->text; *cp; cp++)
 	{
-		if ((*cp >= 'a') && (*cp <= 'z'))
-			continue;
+		if (*cp == '\\')
+		{
+			if (*++cp == '\0')
+				return;
+		}
+		else if (quote)
+		{
+			if (*cp == quote)
+				quote = '\0';
+		}
+		else if ((*cp == '\'') || (*cp == '"'))
+			quote = *cp;
+	}
 
-		if ((*cp >= 'A') && (*cp <= 'Z'))
-			continue;
+	if (quote)
+		return;
 
-		if (isDecimal(*cp))
-			continue;
+	len = strcspn(line->text, " \t");
 
-		if (isBlank(*cp))
-			continue;
+	if (findAlias(line->text, len))
+		return;
 
-		if ((*cp == '.') || (*cp == '/') || (*cp == '-') ||
-			(*cp == '+') || (*cp == '=') || (*cp == '_') ||
-			(*cp == ':') || (*cp == ',') || (*cp == '\'') ||
-			(*cp == '"'))
-		{
-			continue;
-		}
+	entry = findCommand(line->text, len);
+
+	if (entry == NULL)
+		return;
+
+	if (!makeArgs(line->text, &argc, &argv))
+		return;
+
+	if ((argc < entry->minArgs) || (argc > entry->maxArgs))
+		return;
+
+	line->argv = copyArgs(argc, argv);
+
+	if (line->argv == NULL)
+		return;
+
+	line->argc = argc;
+	line->entry = entry;
+}
+
+
+/*
+ * Allocate a line to be run like a line of a script, for the commands
+ * of a control statement.  The text is not copied, and must remain
+ * until the line is freed.  Returns NULL with a message output if there
+ * is no memory.
+ */
+ScriptLine *
+newScriptLine(const char * text)
+{
+	ScriptLine *	line;
+
+	line = (ScriptLine *) malloc(sizeof(ScriptLine));
+
+	if (line == NULL)
+	{
+		fprintf(stderr, "No memory for command\n");
 
-		magic = TRUE;
+		return NULL;
 	}
 
-	/*
-	 * If there were any magic characters used then run the
-	 * command using the shell.
-	 */
-	if (magic)
+	line->text = text;
+	line->entry = NULL;
+	line->argc = 0;
+	line->argv = NULL;
+	line->aliasGeneration = -1;
+
+	return line;
+}
+
+
+/*
+ * Free a line which was allocated by newScriptLine.
+ */
+void
+freeScriptLine(ScriptLine * line)
+{
+	if (line == NULL)
+		return;
+
+	free((char *) line->argv);
+	free((char *) line);
+}
+
+
+/*
+ * Run one line of a script.  The line is parsed the first time that it
+ * is run, since the earlier lines can define aliases which apply to it.
+ * A line which was parsed as a built-in command is run directly, unless
+ * an alias has been defined since then which might now apply to it.
+ */
+void
+runScriptLine(ScriptLine * line)
+{
+	const char **	argv;
+	Trace		trace;
+
+	if ((line->aliasGeneration < 0) || (line->entry &&
+		(line->aliasGeneration != aliasGeneration)))
 	{
-		system(cmd);
+		prepareScriptLine(line);
+	}
+
+	if ((line->entry == NULL) || controlPending())
+	{
+		command(line->text);
 
 		return;
 	}
 
+	intFlag = FALSE;
+
+	freeChunks();
+
 	/*
-	 * No magic characters were in the command, so we can do the fork
-	 * and exec ourself.
+	 * Give the command its own copy of the argument pointers
+	 * since they might be changed.
 	 */
-	pid = fork();
+	argv = (const char **) getChunk(sizeof(char *) * (line->argc + 1));
 
-	if (pid < 0)
+	if (argv == NULL)
 	{
-		perror("fork failed");
+		command(line->text);
 
 		return;
 	}
 
+	memcpy((void *) argv, (const void *) line->argv,
+		sizeof(char *) * (line->argc + 1));
+
+	if (traceFd < 0)
+	{
+		lastStatus = callBuiltIn(line->entry, line->argc, argv);
+
+		return;
+	}
+
+	startTrace(&trace, line->text);
+
+	lastStatus = callBuiltIn(line->entry, line->argc, argv);
+
+	endTrace(&trace, lastStatus);
+}
+
+
+/*
+ * Free a script and its parsed lines.
+ */
+static void
+freeScript(SCRIPT * script)
+{
+	int	i;
+
+	for (i = 0; i < script->lineCount; i++)
+		free((char *) script->lines[i].argv);
+
+	free((char *) script->lines);
+	free(script->data);
+	free(script->name);
+	free((char *) script);
+}
+
+
+/*
+ * Parse and execute one null-terminated command line string.
+ * This breaks the command line up into words, checks to see if the
+ * command is an alias, and expands wildcards.
+ */
+void
+command(const char * cmd)
+{
+	Trace	trace;
+
 	/*
-	 * If we are the child process, then go execute the program.
+	 * Rest the interrupt flag and free any memory chunks that
+	 * were allocated by the previous command.
 	 */
-	if (pid == 0)
-		childProcess(cmd);
+	intFlag = FALSE;
+
+	freeChunks();
 
 	/*
-	 * We are the parent process.
-	 * Wait for the child to complete.
+	 * Skip leading blanks.
 	 */
-	status = 0;
-	intCrlf = FALSE;
+	while (isBlank(*cmd))
+		cmd++;
 
-	while (((pid = waitpid(pid, &status, 0)) < 0) && (errno == EINTR))
-		;
+	/*
+	 * If the command is empty or is a comment then ignore it.
+	 */
+	if ((*cmd == '\0') || (*cmd == '#'))
+		return;
 
-	intCrlf = TRUE;
+	/*
+	 * If the command is part of an if, for, or while statement then
+	 * it is handled there.
+	 */
+	if (controlCommand(cmd))
+		return;
 
-	if (pid < 0)
+	/*
+	 * If tracing is on, then the command is run between the
+	 * points which trace it.
+	 */
+	if (traceFd >= 0)
 	{
-		fprintf(stderr, "Error from waitpid: %s", strerror(errno));
+		startTrace(&trace, cmd);
+		runCommand(cmd, &trace);
+		endTrace(&trace, lastStatus);
 
 		return;
 	}
 
-	if (WIFSIGNALED(status))
-	{
-		fprintf(stderr, "pid %ld: killed by signal %d\n",
-			(long) pid, WTERMSIG(status));
-	}
+	runCommand(cmd, NULL);
 }
 
 
 /*
- * Here as the child process to try to execute the command.
- * This is only called if there are no meta-characters in the command.
- * This procedure never returns.
+ * Run a command line which is not part of a control statement,
+ * setting the exit status.  If the trace is not NULL, then it is
+ * given the command after its aliases and variables are expanded.
  */
 static void
-childProcess(const char * cmd)
+runCommand(const char * cmd, Trace * trace)
 {
-	const char **	argv;
-	int		argc;
+	const char *	simpleCmd;
+	const char *	jobCmd;
+	RedirectList	redirects;
+	StatsMark	mark;
 
 	/*
-	 * Close any extra file descriptors we have opened.
-	 */	
-	while (--sourceCount >= 0)
+	 * If the command is to be timed, then the rest of it is run
+	 * and its resource usage is reported.
+	 */
+	if (isTimed(cmd))
 	{
-		if (sourcefiles[sourceCount] != stdin)
-			fclose(sourcefiles[sourceCount]);
+		timeCommand(cmd);
+
+		return;
 	}
 
 	/*
-	 * Break the command line up into individual arguments.
-	 * If this fails, then run the shell to execute the command.
+	 * If the command is to be run in the background, then start it
+	 * as a job unless it needs the shell to handle other operators.
 	 */
-	if (!makeArgs(cmd, &argc, &argv))
+	jobCmd = takeBackground(cmd);
+
+	if (jobCmd && !hasOperators(jobCmd))
 	{
-		system(cmd);
-		exit(0);
-	}
+		lastStatus = runPipeline(jobCmd, TRUE);
 
-	/*
-	 * Try to execute the program directly.
-	 */
-	execvp(argv[0], (char **) argv);
+		return;
+	}
 
 	/*
-	 * The exec failed, so try to run the command using the shell
-	 * in case it is a shell script.
+	 * If the command is a pipeline then run all of its stages.
 	 */
-	if (errno == ENOEXEC)
+	if (isPipeline(cmd))
 	{
-		system(cmd);
-		exit(0);
+		lastStatus = runPipeline(cmd, FALSE);
+
+		return;
 	}
 
 	/*
-	 * There was something else wrong, complain and exit.
+	 * Expand aliases and variables in the command.
 	 */
-	perror(argv[0]);
-	exit(1);
-}
+	cmd = expandCommand(cmd);
 
+	if (cmd == NULL)
+		return;
 
-void
-do_help(int argc, const char ** argv)
-{
-	const CommandEntry *	entry;
-	const char *		str;
+	if (trace)
+		setTraceText(trace, cmd);
 
-	str = NULL;
+	/*
+	 * Remove any redirections from the command.
+	 */
+	simpleCmd = takeRedirects(cmd, &redirects);
 
-	if (argc == 2)
-		str = argv[1];
+	if (simpleCmd == NULL)
+	{
+		lastStatus = 1;
+
+		return;
+	}
 
 	/*
-	 * Check for an exact match, in which case describe the program.
+	 * Now look for the command in the builtin table or as a function,
+	 * and execute the command if found.
 	 */
-	if (str)
+	if (isBuiltIn(simpleCmd) || isFunction(simpleCmd))
 	{
-		for (entry = commandEntryTable; entry->name; entry++)
-		{
-			if (strcmp(str, entry->name) == 0)
-			{
-				printf("%s\n", entry->description);
+		lastStatus = runBuiltIn(simpleCmd, &redirects);
+
+		return;
+	}
+
+	/*
+	 * The command is not a built-in, so run the program along
+	 * the PATH list.
+	 */
+	if (programStats == NULL)
+		programStats = findStats("[programs]");
+
+	startStats(&mark);
+
+	lastStatus = runCmd(cmd, simpleCmd, &redirects);
+
+	endStats(programStats, &mark);
+}
+
+
+/*
+ * Expand a command by checking to see if the command name is an alias,
+ * and by replacing simple environment variables with their values.
+ * Returns the original command if nothing was expanded, or else a copy
+ * in memory chunks.  Returns NULL with a message output on an error.
+ */
+static const char *
+expandCommand(const char * cmd)
+{
+	const char *	endCmd;
+	const char *	value;
+	const Alias *	alias;
+	char *		newCommand;
+
+	/*
+	 * Look for the end of the command name.
+	 */
+	endCmd = cmd;
+
+	while (*endCmd && !isBlank(*endCmd))
+		endCmd++;
+
+	/*
+	 * Search for the command name in the alias table.
+	 * If it is found, then replace the command name with
+	 * the alias value, and append the current command
+	 * line arguments to that.
+	 */
+	alias = findAlias(cmd, endCmd - cmd);
+
+	if (alias)
+	{
+		value = aliasString(alias->value);
+
+		newCommand = getChunk(strlen(value) + strlen(endCmd) + 1);
+
+		if (newCommand == NULL)
+		{
+			fprintf(stderr, "No memory for command\n");
+
+			return NULL;
+		}
+
+		strcpy(newCommand, value);
+		strcat(newCommand, endCmd);
+
+		cmd = newCommand;
+	}
+
+	/*
+	 * Expand environment variables and command substitutions.
+	 */
+	if (strchr(cmd, '$') || strchr(cmd, '`'))
+		cmd = expandVariables(cmd);
+
+	return cmd;
+}
+
+
+/*
+ * Find the next unquoted occurrence of any of the specified characters
+ * in a command line.  Returns NULL if there is none.
+ */
+static const char *
+findUnquoted(const char * cmd, const char * chars)
+{
+	const char *	end;
+	int		quote;
+
+	quote = '\0';
+
+	for (; *cmd; cmd++)
+	{
+		if (*cmd == '\\')
+		{
+			if (cmd[1] == '\0')
+				break;
+
+			cmd++;
+
+			continue;
+		}
+
+		if (quote)
+		{
+			if (*cmd == quote)
+				quote = '\0';
+
+			continue;
+		}
+
+		if ((*cmd == '\'') || (*cmd == '"'))
+		{
+			quote = *cmd;
+
+			continue;
+		}
+
+		if (strchr(chars, *cmd))
+			return cmd;
+
+		/*
+		 * Skip over command substitutions.
+		 */
+		end = endSubstitution(cmd);
+
+		if (end)
+			cmd = end;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Find the end of a command substitution which starts at the specified
+ * location, which is either "`cmd`" or "$[cmd]" where the brackets can
+ * be nested.  Returns the location of the character which ends it,
+ * or NULL if there is not a complete substitution there.
+ */
+const char *
+endSubstitution(const char * cmd)
+{
+	const char *	cp;
+	int		depth;
+
+	if (*cmd == '`')
+	{
+		for (cp = cmd + 1; *cp && (*cp != '`'); cp++)
+		{
+			if ((*cp == '\\') && cp[1])
+				cp++;
+		}
+
+		return *cp ? cp : NULL;
+	}
+
+	if ((cmd[0] != '$') || (cmd[1] != '['))
+		return NULL;
+
+	depth = 0;
+
+	for (cp = cmd + 1; *cp; cp++)
+	{
+		if ((*cp == '\\') && cp[1])
+			cp++;
+		else if (*cp == '[')
+			depth++;
+		else if ((*cp == ']') && (--depth == 0))
+			return cp;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Return TRUE if a command line has any shell operators other than the
+ * bars of a pipeline, which means that it has to be left for the shell.
+ * The ampersands of redirections such as "2>&1" are allowed.
+ */
+static BOOL
+hasOperators(const char * cmd)
+{
+	const char *	cp;
+
+	for (cp = findUnquoted(cmd, ";&"); cp; cp = findUnquoted(cp + 1, ";&"))
+	{
+		if ((*cp == '&') && (cp > cmd) &&
+			((cp[-1] == '>') || (cp[-1] == '<')))
+		{
+			continue;
+		}
+
+		return TRUE;
+	}
+
+	for (cp = findUnquoted(cmd, "|"); cp; cp = findUnquoted(cp + 1, "|"))
+	{
+		if (cp[1] == '|')
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+/*
+ * Return TRUE if a command line is a simple pipeline which we can run
+ * ourself.
+ */
+static BOOL
+isPipeline(const char * cmd)
+{
+	return (findUnquoted(cmd, "|") != NULL) && !hasOperators(cmd);
+}
+
+
+/*
+ * Check whether a command line ends with an ampersand to run it in
+ * the background.  Returns a copy of the command without the ampersand
+ * in memory chunks, or NULL if it is not to be run in the background.
+ */
+static const char *
+takeBackground(const char * cmd)
+{
+	const char *	cp;
+	const char *	amp;
+	char *		newCmd;
+
+	amp = NULL;
+
+	for (cp = findUnquoted(cmd, "&"); cp; cp = findUnquoted(cp + 1, "&"))
+		amp = cp;
+
+	if ((amp == NULL) || (amp[1] != '\0') || (amp == cmd))
+		return NULL;
+
+	if ((amp[-1] == '&') || (amp[-1] == '>') || (amp[-1] == '<'))
+		return NULL;
+
+	while ((amp > cmd) && isBlank(amp[-1]))
+		amp--;
+
+	newCmd = getChunk(amp - cmd + 1);
+
+	if (newCmd == NULL)
+		return NULL;
+
+	memcpy(newCmd, cmd, amp - cmd);
+	newCmd[amp - cmd] = '\0';
+
+	return newCmd;
+}
+
+
+/*
+ * Try to execute a built-in command or a function.
+ * Returns TRUE if the command is a built in, whether or not the
+ * command succeeds, with its exit status stored through the pointer.
+ * Returns FALSE if this is not a built-in command.
+ */
+static BOOL
+tryBuiltIn(const char * cmd, int * statusPtr)
+{
+	const char *		endCmd;
+	const CommandEntry *	entry;
+	int			argc;
+	const char **		argv;
+
+	/*
+	 * Look for the end of the command name.
+	 */
+	endCmd = cmd;
+
+	while (*endCmd && !isBlank(*endCmd))
+		endCmd++;
+
+	/*
+	 * Search the command table looking for the command name.
+	 */
+	entry = findCommand(cmd, endCmd - cmd);
+
+	/*
+	 * If the command is not a built-in, then it might be a function.
+	 */
+	if (entry == NULL)
+		return runFunction(cmd, statusPtr);
+
+	/*
+	 * The command is a built-in.
+	 * Break the command up into arguments and expand wildcards.
+	 */
+	*statusPtr = 1;
+
+	if (!parseBuiltIn(entry, cmd, &argc, &argv))
+		return TRUE;
+
+	/*
+	 * Call the built-in function with the argument list.
+	 */
+	*statusPtr = callBuiltIn(entry, argc, argv);
+
+	return TRUE;
+}
+
+
+/*
+ * Break up the command line of a built-in command into arguments,
+ * expanding wildcards, and check the number of arguments.  The list
+ * is in static storage.  Returns TRUE if successful, or FALSE with a
+ * message output if the command cannot be run.
+ */
+static BOOL
+parseBuiltIn(const CommandEntry * entry, const char * cmd,
+	int * argcPtr, const char *** argvPtr)
+{
+	if (!makeArgs(cmd, argcPtr, argvPtr))
+		return FALSE;
+
+	/*
+	 * Give a usage string if the number of arguments is too large
+	 * or too small.
+	 */
+	if ((*argcPtr < entry->minArgs) || (*argcPtr > entry->maxArgs))
+	{
+		fprintf(stderr, "usage: %s %s\n", entry->name, entry->usage);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * Call the function of a built-in command with its argument list,
+ * adding what it used to its performance counters.
+ * Returns its exit status.
+ */
+static int
+callBuiltIn(const CommandEntry * entry, int argc, const char ** argv)
+{
+	Stats **	statsPtr;
+	StatsMark	mark;
+	int		status;
+
+	statsPtr = &commandStats[entry - commandEntryTable];
+
+	if (*statsPtr == NULL)
+		*statsPtr = findStats(entry->name);
+
+	startStats(&mark);
+
+	status = entry->func(argc, argv);
+
+	endStats(*statsPtr, &mark);
+
+	return status;
+}
+
+
+/*
+ * Return TRUE if a command is a built-in command.
+ */
+BOOL
+isBuiltIn(const char * cmd)
+{
+	const char *	endCmd;
+
+	endCmd = cmd;
+
+	while (*endCmd && !isBlank(*endCmd))
+		endCmd++;
+
+	return (findCommand(cmd, endCmd - cmd) != NULL);
+}
+
+
+/*
+ * Execute a built-in command with the specified redirections done
+ * around it, restoring our own file descriptors afterwards.
+ * Returns the exit status.
+ */
+static int
+runBuiltIn(const char * cmd, RedirectList * list)
+{
+	int	saved[MAX_REDIRECT];
+	int	status;
+
+	status = 1;
+
+	if (list->count == 0)
+	{
+		tryBuiltIn(cmd, &status);
+
+		return status;
+	}
+
+	if (!openRedirects(list))
+		return 1;
+
+	if (!applyRedirects(list, saved))
+	{
+		closeRedirects(list);
+
+		return 1;
+	}
+
+	tryBuiltIn(cmd, &status);
+
+	restoreRedirects(list, saved, list->count);
+	closeRedirects(list);
+
+	return status;
+}
+
+
+/*
+ * Execute the specified command either by starting the program
+ * ourself, or else by using the shell.  The simple command is the
+ * command with its redirections removed into the specified list.
+ * Returns the exit status.
+ */
+static int
+runCmd(const char * cmd, const char * simpleCmd, RedirectList * list)
+{
+	posix_spawn_file_actions_t	actions;
+	const char **			argv;
+	int				argc;
+	pid_t				pid;
+
+	/*
+	 * If there were any magic characters used then run the
+	 * command using the shell.
+	 */
+	if (hasMagic(simpleCmd))
+		return runShell(cmd);
+
+	/*
+	 * No magic characters were in the command, so we can start the
+	 * program ourself.  Break the command line up into arguments here
+	 * rather than in a forked child, so that the child does not need
+	 * to be a copy of this process.
+	 * If this fails, then run the shell to execute the command.
+	 */
+	if (!makeArgs(simpleCmd, &argc, &argv) || (argc == 0))
+		return runShell(cmd);
+
+	if (list->count == 0)
+		pid = spawnProgram(argv, NULL, NULL);
+	else
+	{
+		/*
+		 * Open the files in this process so that errors are
+		 * reported here, and let the child dup them into place.
+		 */
+		if (!openRedirects(list))
+			return 1;
+
+		posix_spawn_file_actions_init(&actions);
+		addRedirectActions(list, &actions);
+
+		pid = spawnProgram(argv, &actions, NULL);
+
+		posix_spawn_file_actions_destroy(&actions);
+		closeRedirects(list);
+	}
+
+	if (pid < 0)
+		return 127;
+
+	return waitChild(pid);
+}
+
+
+/*
+ * Run a command using the shell and return its exit status.
+ */
+static int
+runShell(const char * cmd)
+{
+	int	status;
+
+	fflush(stdout);
+
+	status = system(cmd);
+
+	if (status < 0)
+		return 127;
+
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+
+	return WEXITSTATUS(status);
+}
+
+
+/*
+ * Check the command for any magic shell characters
+ * except for quoting.
+ */
+static BOOL
+hasMagic(const char * cmd)
+{
+	const char *	cp;
+
+	for (cp = cmd; *cp; cp++)
+	{
+		if ((*cp >= 'a') && (*cp <= 'z'))
+			continue;
+
+		if ((*cp >= 'A') && (*cp <= 'Z'))
+			continue;
+
+		if (isDecimal(*cp))
+			continue;
+
+		if (isBlank(*cp))
+			continue;
+
+		if ((*cp == '.') || (*cp == '/') || (*cp == '-') ||
+			(*cp == '+') || (*cp == '=') || (*cp == '_') ||
+			(*cp == ':') || (*cp == ',') || (*cp == '\'') ||
+			(*cp == '"'))
+		{
+			continue;
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+/*
+ * Wait for a child process to complete and return its exit status.
+ * A child killed by a signal has a status of 128 plus the signal
+ * number, and a message is output about it unless the signal was
+ * just because a pipe was closed.
+ */
+static int
+waitChild(pid_t pid)
+{
+	pid_t	result;
+	int	status;
+
+	status = 0;
+	intCrlf = FALSE;
+
+	while (((result = waitProcess(pid, &status, 0)) < 0) &&
+		(errno == EINTR))
+		;
+
+	intCrlf = TRUE;
+
+	if (result < 0)
+	{
+		fprintf(stderr, "Error from waitpid: %s", strerror(errno));
+
+		return 127;
+	}
+
+	if (WIFSIGNALED(status))
+	{
+		if (WTERMSIG(status) != SIGPIPE)
+		{
+			fprintf(stderr, "pid %ld: killed by signal %d\n",
+				(long) pid, WTERMSIG(status));
+		}
+
+		return 128 + WTERMSIG(status);
+	}
+
+	return WEXITSTATUS(status);
+}
+
+
+/*
+ * Run a pipeline of commands, connecting the output of each stage to
+ * the input of the next one.  If all of the stages are built-in commands
+ * which use streams, then they are run within this process.  Otherwise
+ * built-in commands are run in forked children so that they run at the
+ * same time as the other stages.  The data goes directly between the
+ * stages through the pipes, so it is never copied by us.  Returns the
+ * exit status of the last stage.  A pipeline to be run in the background
+ * is instead added to the job table without waiting for it, and its
+ * processes are put into their own process group so that they do not
+ * get keyboard signals.
+ */
+static int
+runPipeline(const char * cmd, BOOL background)
+{
+	const char **	stages;
+	int		stageCount;
+
+	stages = splitPipeline(cmd, &stageCount);
+
+	if (stages == NULL)
+		return 1;
+
+	return runStages(cmd, stages, stageCount, background);
+}
+
+
+/*
+ * Split a pipeline into its stages and expand each of them.
+ * Returns the stages in memory chunks, or NULL with a message output
+ * on an error.
+ */
+static const char **
+splitPipeline(const char * cmd, int * countPtr)
+{
+	const char *	bar;
+	const char **	stages;
+	char *		stage;
+	int		stageCount;
+	int		i;
+
+	stageCount = 1;
+
+	for (bar = findUnquoted(cmd, "|"); bar; bar = findUnquoted(bar + 1, "|"))
+		stageCount++;
+
+	stages = (const char **) getChunk(sizeof(char *) * stageCount);
+
+	if (stages == NULL)
+	{
+		fprintf(stderr, "No memory for pipeline\n");
+
+		return NULL;
+	}
+
+	/*
+	 * Copy each stage of the pipeline so it can be terminated,
+	 * and expand it.
+	 */
+	for (i = 0; i < stageCount; i++)
+	{
+		bar = findUnquoted(cmd, "|");
+
+		if (bar == NULL)
+			bar = cmd + strlen(cmd);
+
+		stage = getChunk(bar - cmd + 1);
+
+		if (stage == NULL)
+		{
+			fprintf(stderr, "No memory for pipeline\n");
+
+			return NULL;
+		}
+
+		memcpy(stage, cmd, bar - cmd);
+		stage[bar - cmd] = '\0';
+
+		cmd = *bar ? (bar + 1) : bar;
+
+		while (isBlank(*stage))
+			stage++;
+
+		stages[i] = expandCommand(stage);
+
+		if (stages[i] == NULL)
+			return NULL;
+	}
+
+	*countPtr = stageCount;
+
+	return stages;
+}
+
+
+/*
+ * Run the expanded stages of a pipeline as described for runPipeline.
+ * The job command is the text of the whole pipeline.
+ */
+static int
+runStages(const char * jobCmd, const char ** stages, int stageCount,
+	BOOL background)
+{
+	pid_t *		pids;
+	pid_t		pgrp;
+	int		jobCount;
+	int		status;
+	int		inFd;
+	int		outFd;
+	int		fds[2];
+	int		i;
+
+	pids = (pid_t *) getChunk(sizeof(pid_t) * stageCount);
+
+	if (pids == NULL)
+	{
+		fprintf(stderr, "No memory for pipeline\n");
+
+		return 1;
+	}
+
+	if (!background && streamFlag)
+	{
+		status = runStreams(stages, stageCount);
+
+		if (status >= 0)
+			return status;
+	}
+
+	/*
+	 * Don't let a background job be reaped before it is in the
+	 * job table.
+	 */
+	pgrp = -1;
+
+	if (background)
+	{
+		blockJobSignal(TRUE);
+		pgrp = 0;
+	}
+
+	inFd = -1;
+
+	for (i = 0; i < stageCount; i++)
+	{
+		/*
+		 * Make the pipe to the next stage unless this is the last.
+		 */
+		outFd = -1;
+
+		if (i < stageCount - 1)
+		{
+			if (pipe2(fds, O_CLOEXEC) < 0)
+			{
+				perror("pipe");
+				pids[i] = -1;
+
+				break;
+			}
+
+			outFd = fds[1];
+		}
+
+		pids[i] = runStage(stages[i], inFd, outFd, pgrp);
+
+		if (background && (pgrp == 0) && (pids[i] > 0))
+			pgrp = pids[i];
+
+		if (inFd >= 0)
+			close(inFd);
+
+		if (outFd >= 0)
+			close(outFd);
+
+		inFd = fds[0];
+	}
+
+	/*
+	 * If we stopped early, then close the read end of the last pipe
+	 * so that the earlier stages do not hang.
+	 */
+	if ((i < stageCount) && (i > 0))
+		close(inFd);
+
+	while (i < stageCount)
+		pids[i++] = -1;
+
+	/*
+	 * Add a background job to the table with the processes which
+	 * were started.
+	 */
+	if (background)
+	{
+		jobCount = 0;
+
+		for (i = 0; i < stageCount; i++)
+		{
+			if (pids[i] > 0)
+				pids[jobCount++] = pids[i];
+		}
+
+		status = 1;
+
+		if ((jobCount > 0) && addJob(jobCmd, pids, jobCount))
+			status = 0;
+
+		blockJobSignal(FALSE);
+
+		return status;
+	}
+
+	/*
+	 * Wait for all of the stages to finish, remembering the exit
+	 * status of the last one.
+	 */
+	status = 1;
+
+	for (i = 0; i < stageCount; i++)
+	{
+		status = 1;
+
+		if (pids[i] > 0)
+			status = waitChild(pids[i]);
+	}
+
+	return status;
+}
+
+
+/*
+ * Run the expanded stages of a pipeline within this process if all of
+ * them are built-in commands which only use streams for their I/O and
+ * have no redirections.  This needs no forks or pipes.  Returns the exit
+ * status, or -1 if the pipeline needs to be run using processes.
+ */
+static int
+runStreams(const char ** cmds, int count)
+{
+	const CommandEntry *	entry;
+	const StreamCommand *	streamCommand;
+	StreamStage *		stages;
+	const char *		endCmd;
+	const char **		argv;
+	int			argc;
+	int			i;
+	int			j;
+
+	stages = (StreamStage *) getChunk(sizeof(StreamStage) * count);
+
+	if (stages == NULL)
+		return -1;
+
+	for (i = 0; i < count; i++)
+	{
+		if (findUnquoted(cmds[i], "<>"))
+			return -1;
+
+		endCmd = cmds[i];
+
+		while (*endCmd && !isBlank(*endCmd))
+			endCmd++;
+
+		entry = findCommand(cmds[i], endCmd - cmds[i]);
+
+		if (entry == NULL)
+			return -1;
+
+		for (streamCommand = streamCommandTable; streamCommand->name;
+			streamCommand++)
+		{
+			if (strcmp(streamCommand->name, entry->name) == 0)
+				break;
+		}
+
+		if (streamCommand->name == NULL)
+			return -1;
+
+		for (j = 0; !streamCommand->reentrant && (j < i); j++)
+		{
+			if (stages[j].func == entry->func)
+				return -1;
+		}
+
+		stages[i].func = entry->func;
+	}
+
+	/*
+	 * Make the argument lists.  They are copied since they are
+	 * otherwise in static storage.  A stage whose arguments are
+	 * bad still runs, but just reads its input.
+	 */
+	for (i = 0; i < count; i++)
+	{
+		entry = findCommand(cmds[i], strcspn(cmds[i], " \t"));
+
+		stages[i].argc = 0;
+		stages[i].argv = NULL;
+
+		if (!parseBuiltIn(entry, cmds[i], &argc, &argv))
+		{
+			stages[i].func = NULL;
+
+			continue;
+		}
+
+		stages[i].argv = (const char **)
+			getChunk(sizeof(char *) * (argc + 1));
+
+		if (stages[i].argv == NULL)
+		{
+			fprintf(stderr, "No memory for arg list\n");
+
+			return 1;
+		}
+
+		for (j = 0; j < argc; j++)
+		{
+			stages[i].argv[j] = chunkstrdup(argv[j]);
+
+			if (stages[i].argv[j] == NULL)
+			{
+				fprintf(stderr, "No memory for arg list\n");
+
+				return 1;
+			}
+		}
+
+		stages[i].argv[argc] = NULL;
+		stages[i].argc = argc;
+	}
+
+	/*
+	 * A single command needs no coroutine, and is called through
+	 * its own entry.
+	 */
+	if (count == 1)
+	{
+		if (stages[0].func == NULL)
+			return 1;
+
+		entry = findCommand(cmds[0], strcspn(cmds[0], " \t"));
+
+		return callBuiltIn(entry, stages[0].argc, stages[0].argv);
+	}
+
+	return runStreamPipeline(stages, count);
+}
+
+
+/*
+ * Start one expanded stage of a pipeline with the specified file
+ * descriptors for its standard input and output, or -1 to leave them
+ * alone.  If the process group is not -1, then the stage is part of a
+ * background job and is put into that process group, or into a new one
+ * if it is zero, and its standard input defaults to /dev/null.
+ * Returns the process id of the stage, or -1 on an error.
+ */
+static pid_t
+runStage(const char * cmd, int inFd, int outFd, pid_t pgrp)
+{
+	posix_spawn_file_actions_t	actions;
+	posix_spawnattr_t		attrs;
+	sigset_t			sigs;
+	const char *			shellArgv[4];
+	const char *			simpleCmd;
+	const char **			argv;
+	RedirectList			redirects;
+	int				argc;
+	int				status;
+	pid_t				pid;
+
+	simpleCmd = takeRedirects(cmd, &redirects);
+
+	if (simpleCmd == NULL)
+		return -1;
+
+	/*
+	 * If the stage is a built-in command or a function, then fork
+	 * a copy of ourself to run it.  The redirections are done after
+	 * the pipes are connected, as the shell does.
+	 */
+	if (isBuiltIn(simpleCmd) || isFunction(simpleCmd))
+	{
+		if (!openRedirects(&redirects))
+			return -1;
+
+		fflush(stdout);
+
+		pid = fork();
+
+		if (pid < 0)
+		{
+			perror("fork failed");
+			closeRedirects(&redirects);
+
+			return -1;
+		}
+
+		if (pid == 0)
+		{
+			if (pgrp >= 0)
+			{
+				setpgid(0, pgrp);
+				blockJobSignal(FALSE);
+
+				if (inFd < 0)
+					inFd = open("/dev/null", O_RDONLY);
+			}
+
+			/*
+			 * Throw away any of our own input which was buffered
+			 * so that the command reads only from the pipe.
+			 */
+			if (inFd >= 0)
+			{
+				dup2(inFd, STDIN);
+				__fpurge(stdin);
+			}
+
+			if (outFd >= 0)
+				dup2(outFd, STDOUT);
+
+			if (!applyRedirects(&redirects, NULL))
+				_exit(1);
+
+			status = 1;
+			tryBuiltIn(simpleCmd, &status);
+
+			fflush(stdout);
+			_exit(status);
+		}
+
+		if (pgrp >= 0)
+			setpgid(pid, pgrp ? pgrp : pid);
+
+		closeRedirects(&redirects);
+
+		return pid;
+	}
+
+	/*
+	 * Run the program directly if possible, or else using the shell,
+	 * which then does the redirections itself.
+	 */
+	if (hasMagic(simpleCmd) || !makeArgs(simpleCmd, &argc, &argv) ||
+		(argc == 0))
+	{
+		shellArgv[0] = "/bin/sh";
+		shellArgv[1] = "-c";
+		shellArgv[2] = cmd;
+		shellArgv[3] = NULL;
+		argv = shellArgv;
+		redirects.count = 0;
+	}
+
+	if (!openRedirects(&redirects))
+		return -1;
+
+	posix_spawn_file_actions_init(&actions);
+
+	if (inFd >= 0)
+		posix_spawn_file_actions_adddup2(&actions, inFd, STDIN);
+
+	if (outFd >= 0)
+		posix_spawn_file_actions_adddup2(&actions, outFd, STDOUT);
+
+	if ((inFd < 0) && (pgrp >= 0))
+	{
+		posix_spawn_file_actions_addopen(&actions, STDIN,
+			"/dev/null", O_RDONLY, 0);
+	}
+
+	addRedirectActions(&redirects, &actions);
+
+	if (pgrp < 0)
+		pid = spawnProgram(argv, &actions, NULL);
+	else
+	{
+		/*
+		 * The SIGCHLD signal is blocked while a job is being
+		 * started, so don't pass that on.
+		 */
+		sigemptyset(&sigs);
+
+		posix_spawnattr_init(&attrs);
+		posix_spawnattr_setpgroup(&attrs, pgrp);
+		posix_spawnattr_setsigmask(&attrs, &sigs);
+		posix_spawnattr_setflags(&attrs,
+			POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+
+		pid = spawnProgram(argv, &actions, &attrs);
+
+		posix_spawnattr_destroy(&attrs);
+	}
+
+	posix_spawn_file_actions_destroy(&actions);
+	closeRedirects(&redirects);
+
+	return pid;
+}
+
+
+/*
+ * Start a command line running in a child process with the specified
+ * file descriptors for its standard input and output, or -1 to leave
+ * them alone.  This is for built-in commands which run other commands.
+ * Returns the process id of the child, or -1 on an error.
+ */
+pid_t
+startCommand(const char * cmd, int inFd, int outFd)
+{
+	return runStage(cmd, inFd, outFd, -1);
+}
+
+
+/*
+ * Run a command which is already broken up into a NULL terminated
+ * argument list, either as a built-in command or as a program.
+ * This is for built-in commands which run other commands within
+ * this process.  Returns the exit status.
+ */
+int
+runArgs(int argc, const char ** argv)
+{
+	const CommandEntry *	entry;
+	pid_t			pid;
+
+	entry = findCommand(argv[0], strlen(argv[0]));
+
+	if (entry)
+	{
+		if ((argc < entry->minArgs) || (argc > entry->maxArgs))
+		{
+			fprintf(stderr, "usage: %s %s\n", entry->name,
+				entry->usage);
+
+			return 1;
+		}
+
+		return callBuiltIn(entry, argc, argv);
+	}
+
+	pid = spawnProgram(argv, NULL, NULL);
+
+	if (pid < 0)
+		return 127;
+
+	return waitChild(pid);
+}
+
+
+/*
+ * Start a program running with the specified NULL terminated argument
+ * list, using the remembered location of the program if it is known.
+ * The child is created with posix_spawn, which avoids copying this
+ * process as a fork would.  The file actions and the spawn attributes
+ * are applied in the child if they are not NULL.  Programs which cannot
+ * be executed directly are run as shell scripts.  Returns the process
+ * id of the child, or -1 with a message output on failure.
+ */
+static pid_t
+spawnProgram(const char ** argv, const posix_spawn_file_actions_t * actions,
+	const posix_spawnattr_t * attrs)
+{
+	const char *	path;
+	const char **	shellArgv;
+	extern char **	environ;
+	pid_t		pid;
+	int		argc;
+	int		err;
+
+	path = findProgram(argv[0]);
+
+	if (path == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(ENOENT));
+
+		return -1;
+	}
+
+	/*
+	 * Flush our output so that the output of the program is not
+	 * mixed up with it.
+	 */
+	fflush(stdout);
+
+	err = posix_spawn(&pid, path, actions, attrs, (char **) argv, environ);
+
+	/*
+	 * If the remembered location of the program has become wrong,
+	 * then fall back to searching the PATH again.
+	 */
+	if ((err == ENOENT) && (path != argv[0]))
+	{
+		err = posix_spawnp(&pid, argv[0], actions, attrs,
+			(char **) argv, environ);
+	}
+
+	/*
+	 * If the program is not an executable, then give it to the
+	 * shell in case it is a shell script.
+	 */
+	if (err == ENOEXEC)
+	{
+		for (argc = 0; argv[argc]; argc++)
+			;
+
+		shellArgv = (const char **) getChunk(sizeof(char *) * (argc + 2));
+
+		if (shellArgv == NULL)
+		{
+			fprintf(stderr, "No memory for arg list\n");
+
+			return -1;
+		}
+
+		shellArgv[0] = "sh";
+		shellArgv[1] = path;
+		memcpy((void *) &shellArgv[2], (const void *) &argv[1],
+			sizeof(char *) * argc);
+
+		err = posix_spawn(&pid, "/bin/sh", actions, attrs,
+			(char **) shellArgv, environ);
+	}
+
+	if (err)
+	{
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(err));
+
+		return -1;
+	}
+
+	return pid;
+}
+
+
+int
+do_help(int argc, const char ** argv)
+{
+	const CommandEntry *	entry;
+	const char *		str;
+
+	str = NULL;
+
+	if (argc == 2)
+		str = argv[1];
+
+	/*
+	 * Check for an exact match, in which case describe the program.
+	 */
+	if (str)
+	{
+		entry = findCommand(str, strlen(str));
+
+		if (entry)
+		{
+			printf("%s\n", entry->description);
+
+			printf("usage: %s %s\n", entry->name, entry->usage);
+
+			return 0;
+		}
+	}
+
+	/*
+	 * Print short information about commands which contain the
+	 * specified word.
+	 */
+	for (entry = commandEntryTable; entry->name; entry++)
+	{
+		if ((str == NULL) || (strstr(entry->name, str) != NULL) ||
+			(strstr(entry->usage, str) != NULL))
+		{
+			printf("%-10s %s\n", entry->name, entry->usage);
+		}
+	}
+
+	return 0;
+}
+
+
+int
+do_alias(int argc, const char ** argv)
+{
+	const char *	name;
+	Alias *		alias;
+	int		count;
+	int		slot;
+	int		oldLen;
+	char *		buf;
+
+	if (argc < 2)
+	{
+		count = aliasCount;
+
+		for (alias = aliasTable; count-- > 0; alias++)
+		{
+			printf("%s\t%s\n", aliasString(alias->name),
+				aliasString(alias->value));
+		}
+
+		return 0;
+	}
+
+	name = argv[1];
+
+	if (argc == 2)
+	{
+		alias = findAlias(name, strlen(name));
+
+		if (alias == NULL)
+		{
+			fprintf(stderr, "Alias \"%s\" is not defined\n", name);
+
+			return 1;
+		}
+
+		printf("%s\n", aliasString(alias->value));
+
+		return 0;
+	}
+
+	if (strcmp(name, "alias") == 0)
+	{
+		fprintf(stderr, "Cannot alias \"alias\"\n");
+
+		return 1;
+	}
+
+	buf = makeString(argc - 2, argv + 2);
+
+	if (buf == NULL)
+		return 1;
+
+	alias = findAlias(name, strlen(name));
+
+	if (alias)
+	{
+		oldLen = strlen(aliasString(alias->value)) + 1;
+
+		if (!reserveAliasArena(strlen(buf) + 1))
+			return 1;
+
+		alias->value = addAliasString(buf);
+		aliasArenaGarbage += oldLen;
+
+		return 0;
+	}
+
+	if ((aliasCount % ALIAS_ALLOC) == 0)
+	{
+		count = aliasCount + ALIAS_ALLOC;
+
+		if (aliasTable)
+		{
+			alias = (Alias *) realloc(aliasTable,
+				sizeof(Alias) * count);
+		}
+		else
+			alias = (Alias *) malloc(sizeof(Alias) * count);
+
+		if (alias == NULL)
+		{
+			fprintf(stderr, "No memory for alias table\n");
+
+			return 1;
+		}
+
+		aliasTable = alias;
+	}
+
+	if (((aliasCount + 1) * 2 > aliasHashSize) && !growAliasHash())
+		return 1;
+
+	if (!reserveAliasArena(strlen(name) + strlen(buf) + 2))
+		return 1;
+
+	alias = &aliasTable[aliasCount];
+	alias->name = addAliasString(name);
+	alias->value = addAliasString(buf);
+
+	slot = findAliasSlot(name, strlen(name));
+	aliasHash[slot] = ++aliasCount;
+	aliasGeneration++;
+
+	return 0;
+}
+
+
+/*
+ * Build aliases for all of the built-in commands which start with a dash,
+ * using the names without the dash.
+ */
+int
+do_aliasall(int argc, const char **argv)
+{
+	const CommandEntry *	entry;
+	const char *		name;
+	const char *		newArgv[4];
+
+	for (entry = commandEntryTable; entry->name; entry++)
+	{
+		name = entry->name;
+
+		if (*name != '-')
+			continue;
+
+		newArgv[0] = "alias";
+		newArgv[1] = name + 1;
+		newArgv[2] = name;
+		newArgv[3] = NULL;
+
+		do_alias(3, newArgv);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Look up an alias name of the specified length (which need not be
+ * null terminated), and return a pointer to it.
+ * Returns NULL if the name does not exist.
+ */
+static Alias *
+findAlias(const char * name, int len)
+{
+	int	index;
+
+	if (aliasCount == 0)
+		return NULL;
+
+	index = aliasHash[findAliasSlot(name, len)];
+
+	if (index == 0)
+		return NULL;
+
+	return &aliasTable[index - 1];
+}
+
+
+/*
+ * Find the slot in the alias hash table which contains the specified
+ * alias name, or else the empty slot where the name would be stored.
+ * The hash table must have been allocated.
+ */
+static int
+findAliasSlot(const char * name, int len)
+{
+	int	mask;
+	int	slot;
+	int	index;
+
+	mask = aliasHashSize - 1;
+	slot = hashName(name, len) & mask;
+
+	while ((index = aliasHash[slot]) != 0)
+	{
+		if (nameCompare(name, len,
+			aliasString(aliasTable[index - 1].name)) == 0)
+		{
+			break;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+
+/*
+ * Empty a slot of the alias hash table, moving back any following
+ * entries of the probe sequence so that lookups do not need markers
+ * for deleted entries.
+ */
+static void
+removeAliasSlot(int slot)
+{
+	const char *	name;
+	int		mask;
+	int		next;
+	int		home;
+
+	mask = aliasHashSize - 1;
+	next = slot;
+
+	while (TRUE)
+	{
+		next = (next + 1) & mask;
+
+		if (aliasHash[next] == 0)
+			break;
+
+		name = aliasString(aliasTable[aliasHash[next] - 1].name);
+		home = hashName(name, strlen(name)) & mask;
+
+		/*
+		 * Leave the entry alone if its home slot is cyclically
+		 * between the emptied slot and its current slot.
+		 */
+		if ((slot <= next) ? ((slot < home) && (home <= next)) :
+			((slot < home) || (home <= next)))
+		{
+			continue;
+		}
+
+		aliasHash[slot] = aliasHash[next];
+		slot = next;
+	}
+
+	aliasHash[slot] = 0;
+}
+
+
+/*
+ * Double the size of the alias hash table and rehash the aliases into it.
+ * Returns TRUE if successful, or FALSE with a message output on failure.
+ */
+static BOOL
+growAliasHash(void)
+{
+	const char *	name;
+	int *		oldHash;
+	int		oldSize;
+	int		index;
+
+	oldHash = aliasHash;
+	oldSize = aliasHashSize;
+
+	aliasHashSize = oldSize ? (oldSize * 2) : ALIAS_HASH_INIT;
+	aliasHash = (int *) calloc(aliasHashSize, sizeof(int));
+
+	if (aliasHash == NULL)
+	{
+		aliasHash = oldHash;
+		aliasHashSize = oldSize;
+		fprintf(stderr, "No memory for alias hash table\n");
+
+		return FALSE;
+	}
+
+	for (index = 0; index < aliasCount; index++)
+	{
+		name = aliasString(aliasTable[index].name);
+		aliasHash[findAliasSlot(name, strlen(name))] = index + 1;
+	}
+
+	free(oldHash);
+
+	return TRUE;
+}
+
+
+/*
+ * Make sure that there is room for the specified number of bytes of
+ * strings in the alias arena, growing the arena and reclaiming the
+ * garbage in it if necessary.  Returns TRUE if successful, or FALSE
+ * with a message output on failure.
+ */
+static BOOL
+reserveAliasArena(int len)
+{
+	Alias *	alias;
+	char *	newArena;
+	int	newSize;
+	int	newUsed;
+	int	index;
+
+	if (aliasArenaUsed + len <= aliasArenaSize)
+		return TRUE;
+
+	newSize = aliasArenaSize ? aliasArenaSize : ALIAS_ARENA_INIT;
+
+	while ((aliasArenaUsed - aliasArenaGarbage + len) * 2 > newSize)
+		newSize *= 2;
+
+	newArena = malloc(newSize);
+
+	if (newArena == NULL)
+	{
+		fprintf(stderr, "No memory for alias strings\n");
+
+		return FALSE;
+	}
+
+	/*
+	 * Copy only the live strings into the new arena.
+	 */
+	newUsed = 0;
+
+	for (index = 0; index < aliasCount; index++)
+	{
+		alias = &aliasTable[index];
+
+		strcpy(newArena + newUsed, aliasString(alias->name));
+		alias->name = newUsed;
+		newUsed += strlen(newArena + newUsed) + 1;
+
+		strcpy(newArena + newUsed, aliasString(alias->value));
+		alias->value = newUsed;
+		newUsed += strlen(newArena + newUsed) + 1;
+	}
+
+	free(aliasArena);
+
+	aliasArena = newArena;
+	aliasArenaSize = newSize;
+	aliasArenaUsed = newUsed;
+	aliasArenaGarbage = 0;
+
+	return TRUE;
+}
+
+
+/*
+ * Copy a string into the alias arena and return its offset.
+ * Room for the string must have already been reserved.
+ */
+static int
+addAliasString(const char * str)
+{
+	int	len;
+
+	len = strlen(str) + 1;
+
+	memcpy(aliasArena + aliasArenaUsed, str, len);
+	aliasArenaUsed += len;
+
+	return aliasArenaUsed - len;
+}
+
+
+/*
+ * Look up a built-in command given its name and length, using a binary
+ * search of the sorted command index.  The name does not need to be
+ * null terminated.  Returns NULL if the name is not a built-in command.
+ */
+static const CommandEntry *
+findCommand(const char * name, int len)
+{
+	const CommandEntry *	entry;
+	int			low;
+	int			high;
+	int			mid;
+	int			cmp;
+
+	/*
+	 * Build the sorted index of the command table if necessary.
+	 */
+	if (commandIndexCount == 0)
+	{
+		for (entry = commandEntryTable; entry->name; entry++)
+			commandIndex[commandIndexCount++] = entry;
+
+		qsort((void *) commandIndex, commandIndexCount,
+			sizeof(const CommandEntry *), commandSort);
+	}
+
+	low = 0;
+	high = commandIndexCount - 1;
+
+	while (low <= high)
+	{
+		mid = (low + high) / 2;
+
+		cmp = nameCompare(name, len, commandIndex[mid]->name);
+
+		if (cmp == 0)
+			return commandIndex[mid];
+
+		if (cmp < 0)
+			high = mid - 1;
+		else
+			low = mid + 1;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Sort routine for the command index.
+ */
+static int
+commandSort(const void * p1, const void * p2)
+{
+	const CommandEntry * const *	e1;
+	const CommandEntry * const *	e2;
+
+	e1 = (const CommandEntry * const *) p1;
+	e2 = (const CommandEntry * const *) p2;
+
+	return strcmp((*e1)->name, (*e2)->name);
+}
+
+
+/*
+ * Compare a name of the specified length (which need not be null
+ * terminated) against a null terminated command name in the same
+ * manner as strcmp.
+ */
+static int
+nameCompare(const char * name, int len, const char * entryName)
+{
+	int	cmp;
+
+	cmp = strncmp(name, entryName, len);
+
+	if (cmp)
+		return cmp;
+
+	return -((unsigned char) entryName[len]);
+}
+
+
+int
+do_source(int argc, const char ** argv)
+{
+	lastStatus = 0;
+
+	readFile(argv[1]);
+
+	return lastStatus;
+}
+
+
+int
+do_exec(int argc, const char ** argv)
+{
+	const char *	name;
+
+	name = argv[1];
+
+	if (access(name, 4))
+	{
+		perror(name);
+
+		return 1;
+	}
+
+	while (--sourceCount >= 0)
+	{
+		if (sourcefiles[sourceCount] &&
+			(sourcefiles[sourceCount] != stdin))
+		{
+			fclose(sourcefiles[sourceCount]);
+		}
+	}
+
+	argv[argc] = NULL;
+
+	execvp(name, (char **) argv + 1);
+	exit(1);
+}
+
+
+int
+do_prompt(int argc, const char ** argv)
+{
+	char *	cp;
+	char *	buf;
+
+	buf = makeString(argc - 1, argv + 1);
+
+	if (buf == NULL)
+		return 1;
+
+	cp = malloc(strlen(buf) + 2);
+
+	if (cp == NULL)
+	{
+		fprintf(stderr, "No memory for prompt\n");
+
+		return 1;
+	}
+
+	strcpy(cp, buf);
+	strcat(cp, " ");
+
+	if (prompt)
+		free(prompt);
+
+	prompt = cp;
+
+	return 0;
+}
+
+
+int
+do_unalias(int argc, const char ** argv)
+{
+	const char *	name;
+	Alias *		alias;
+	Alias *		last;
+	int		slot;
+
+	while (--argc > 0)
+	{
+		name = *++argv;
+
+		if (aliasCount == 0)
+			break;
+
+		slot = findAliasSlot(name, strlen(name));
+
+		if (aliasHash[slot] == 0)
+			continue;
+
+		alias = &aliasTable[aliasHash[slot] - 1];
+
+		aliasArenaGarbage += strlen(aliasString(alias->name)) + 1;
+		aliasArenaGarbage += strlen(aliasString(alias->value)) + 1;
+
+		removeAliasSlot(slot);
+
+		/*
+		 * Move the last alias into the freed table entry.
+		 */
+		aliasCount--;
+		last = &aliasTable[aliasCount];
+
+		if (alias != last)
+		{
+			name = aliasString(last->name);
+			slot = findAliasSlot(name, strlen(name));
+			aliasHash[slot] = (alias - aliasTable) + 1;
+			*alias = *last;
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Display the prompt string.
+ */
+static void
+showPrompt(void)
+{
+	const char *	cp;
+
+	cp = "> ";
+
+	if (prompt)
+		cp = prompt;
+
+	if (controlPending())
+		cp = "... ";
+
+	write(STDOUT, cp, strlen(cp));
+}	
+
+
+static void
+catchInt(int val)
+{
+	signal(SIGINT, catchInt);
+
+	intFlag = TRUE;
+
+	if (intCrlf)
+		write(STDOUT, "\n", 1);
+}
+
+
+static void
+catchQuit(int val)
+{
+	signal(SIGQUIT, catchQuit);
+
+	intFlag = TRUE;
+
+	if (intCrlf)
+		write(STDOUT, "\n", 1);
+}
+
+
+/*
+ * Prepare for running when the system is out of memory.  The stack
+ * and heap are grown and touched in advance, an emergency reserve is
+ * set aside for the chunk allocator, all of our memory is locked into
+ * RAM, and we ask not to be picked by the out of memory killer.
+ * Problems are reported but are not fatal.
+ */
+static void
+reserveMemory(void)
+{
+	char *	cp;
+	int	fd;
+
+	touchStack();
+
+	/*
+	 * Keep malloc from giving freed memory back to the system or
+	 * using separate mappings, then grow the heap and free it again.
+	 */
+	mallopt(M_MMAP_MAX, 0);
+	mallopt(M_TRIM_THRESHOLD, INT_MAX);
+
+	cp = malloc(HEAP_RESERVE_SIZE);
+
+	if (cp)
+	{
+		memset(cp, 0, HEAP_RESERVE_SIZE);
+		free(cp);
+	}
+
+	if ((cp == NULL) || !reserveChunks(CHUNK_RESERVE_SIZE))
+		fprintf(stderr, "Cannot allocate the memory reserve\n");
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+		perror("mlockall");
+
+	fd = open("/proc/self/oom_score_adj", O_WRONLY);
+
+	if ((fd < 0) || (write(fd, "-1000", 5) != 5))
+		perror("oom_score_adj");
+
+	if (fd >= 0)
+		close(fd);
+}
+
+
+/*
+ * Touch the stack down to the size of the reserve so that its pages
+ * are present before they are locked.  The value returned is only
+ * there so that the touching is not optimized away.
+ */
+static int
+touchStack(void)
+{
+	volatile char	buf[STACK_RESERVE_SIZE];
+	int		i;
+
+	for (i = 0; i < STACK_RESERVE_SIZE; i += 1024)
+		buf[i] = 0;
+
+	return buf[0];
+}
+
+
+/*
+ * Run the built-in command whose name we were called by, as in "ls"
+ * for the "-ls" command, with our arguments as they are.  Nothing else
+ * is initialized, and no aliases or startup files are read.  Returns
+ * TRUE if the command was run, with its exit status stored through the
+ * pointer, or FALSE if the name is not that of a built-in command.
+ */
+static BOOL
+runCalledAs(int argc, const char ** argv, int * statusPtr)
+{
+	const CommandEntry *	entry;
+	const char *		name;
+	char			buf[32];
+	int			len;
+
+	name = strrchr(argv[0], '/');
+	name = name ? (name + 1) : argv[0];
+	len = strlen(name);
+
+	/*
+	 * A login shell has a name starting with a dash.
+	 */
+	if ((*name == '-') || (len == 0) || (len >= (int) sizeof(buf) - 1) ||
+		(strcmp(name, "sash") == 0))
+	{
+		return FALSE;
+	}
+
+	buf[0] = '-';
+	strcpy(buf + 1, name);
+
+	entry = findCommand(buf, len + 1);
+
+	if (entry == NULL)
+		entry = findCommand(name, len);
+
+	if (entry == NULL)
+		return FALSE;
+
+	*statusPtr = 1;
+
+	if ((argc < entry->minArgs) || (argc > entry->maxArgs))
+	{
+		fprintf(stderr, "usage: %s %s\n", name, entry->usage);
+
+		return TRUE;
+	}
+
+	*statusPtr = callBuiltIn(entry, argc, argv);
+
+	fflush(stdout);
+
+	return TRUE;
+}
+
+
+/*
+ * Print the usage information and quit.
+ */
+static void
+usage(void)
+{
+	fprintf(stderr, "Stand-alone shell (version %s)\n", version);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Usage: sash [-a] [-q] [-m] [-x] [-P] [-c command] [-p prompt]\n");
+	fprintf(stderr, "       sash [-a] [-m] [-x] [-P] -S socket\n");
+	fprintf(stderr, "       sash -C socket command\n");
+
+	exit(1);
+}
+
+
+/*
+ * Expand the environment variables in a command in a single pass.
+ * The forms $VAR, ${VAR}, and $(VAR) are recognized, and a variable
+ * which is not set expands to nothing.  Command substitutions of the
+ * forms `cmd` and $[cmd] are replaced by the output of the command.
+ * Nothing is expanded within single quotes or when the dollar sign or
+ * back quote is quoted by a backslash.  Returns a copy of the expanded
+ * command in memory chunks, or NULL with a message output on an error.
+ */
+const char *
+expandVariables(const char * cmd)
+{
+	const char *	cp;
+	const char *	name;
+	const char *	value;
+	char *		newCmd;
+	int		len;
+	int		quote;
+	int		endChar;
+	char		statusBuf[16];
+
+	expandUsed = 0;
+	quote = '\0';
+	cp = cmd;
+
+	while (*cp)
+	{
+		/*
+		 * Copy everything up to the next interesting character.
+		 */
+		len = strcspn(cp, "$\\'\"`");
 
-				printf("usage: %s %s\n", entry->name,
-					entry->usage);
+		if (!appendExpansion(cp, len))
+			return NULL;
 
-				return;
-			}
-		}
-	}
+		cp += len;
 
-	/*
-	 * Print short information about commands which contain the
-	 * specified word.
-	 */
-	for (entry = commandEntryTable; entry->name; entry++)
-	{
-		if ((str == NULL) || (strstr(entry->name, str) != NULL) ||
-			(strstr(entry->usage, str) != NULL))
+		if (*cp == '\0')
+			break;
+
+		if (*cp == '\\')
 		{
-			printf("%-10s %s\n", entry->name, entry->usage);
-		}
-	}
-}
+			len = cp[1] ? 2 : 1;
 
+			if (!appendExpansion(cp, len))
+				return NULL;
 
-void
-do_alias(int argc, const char ** argv)
-{
-	const char *	name;
-	char *		value;
-	Alias *		alias;
-	int		count;
-	char		buf[CMD_LEN];
+			cp += len;
 
-	if (argc < 2)
-	{
-		count = aliasCount;
+			continue;
+		}
 
-		for (alias = aliasTable; count-- > 0; alias++)
-			printf("%s\t%s\n", alias->name, alias->value);
+		if ((*cp == '\'') || (*cp == '"'))
+		{
+			if (quote == '\0')
+				quote = *cp;
+			else if (quote == *cp)
+				quote = '\0';
 
-		return;
-	}
+			if (!appendExpansion(cp++, 1))
+				return NULL;
 
-	name = argv[1];
+			continue;
+		}
 
-	if (argc == 2)
-	{
-		alias = findAlias(name);
+		if ((quote != '\'') && ((*cp == '`') || (cp[1] == '[')))
+		{
+			cp = substituteCommand(cp);
 
-		if (alias)
-			printf("%s\n", alias->value);
-		else
-			fprintf(stderr, "Alias \"%s\" is not defined\n", name);
+			if (cp == NULL)
+				return NULL;
 
-		return;	
-	}
+			continue;
+		}
 
-	if (strcmp(name, "alias") == 0)
-	{
-		fprintf(stderr, "Cannot alias \"alias\"\n");
+		if (*cp == '`')
+		{
+			if (!appendExpansion(cp++, 1))
+				return NULL;
 
-		return;
-	}
+			continue;
+		}
 
-	if (!makeString(argc - 2, argv + 2, buf, CMD_LEN))
-		return;
+		/*
+		 * This is a dollar sign, so look for a variable name after it.
+		 */
+		name = cp + 1;
+		endChar = '\0';
 
-	value = malloc(strlen(buf) + 1);
+		if (*name == '(')
+			endChar = ')';
+		else if (*name == '{')
+			endChar = '}';
 
-	if (value == NULL)
-	{
-		fprintf(stderr, "No memory for alias value\n");
+		if (endChar)
+		{
+			name++;
+			len = 0;
 
-		return;
-	}
+			while (name[len] && (name[len] != endChar))
+				len++;
 
-	strcpy(value, buf);
+			cp = name + len;
 
-	alias = findAlias(name);
+			if (*cp)
+				cp++;
+		}
+		else
+		{
+			len = 0;
 
-	if (alias)
-	{
-		free(alias->value);
-		alias->value = value;
+			while (isalnum((unsigned char) name[len]) ||
+				(name[len] == '_'))
+			{
+				len++;
+			}
 
-		return;
-	}
+			/*
+			 * Special variables and positional parameters have
+			 * names of one character.
+			 */
+			if (isDecimal(*name) || (*name && strchr("?#@*", *name)))
+				len = 1;
 
-	if ((aliasCount % ALIAS_ALLOC) == 0)
-	{
-		count = aliasCount + ALIAS_ALLOC;
+			cp = name + len;
+		}
 
-		if (aliasTable)
+		/*
+		 * The special variable "?" is the exit status of the
+		 * previous command.  The positional parameters are only
+		 * set while a function is running.
+		 */
+		if ((quote == '\'') || (len == 0))
+			value = NULL;
+		else if ((len == 1) && (*name == '?'))
 		{
-			alias = (Alias *) realloc(aliasTable,
-				sizeof(Alias) * count);
+			sprintf(statusBuf, "%d", lastStatus);
+			value = statusBuf;
+		}
+		else if (isDecimal(*name) || strchr("#@*", *name))
+		{
+			value = findParameter(name, len);
+
+			if (value == NULL)
+				len = 0;
 		}
 		else
-			alias = (Alias *) malloc(sizeof(Alias) * count);
+			value = findVariable(name, len);
 
-		if (alias == NULL)
+		if ((quote == '\'') || (len == 0))
 		{
-			free(value);
-			fprintf(stderr, "No memory for alias table\n");
+			/*
+			 * Not a variable, so keep the text as it is.
+			 */
+			if (!appendExpansion(name - 1, cp - name + 1))
+				return NULL;
 
-			return;
+			continue;
 		}
 
-		aliasTable = alias;
+		if (value && !appendExpansion(value, strlen(value)))
+			return NULL;
 	}
 
-	alias = &aliasTable[aliasCount];
+	if (!appendExpansion("", 1))
+		return NULL;
 
-	alias->name = malloc(strlen(name) + 1);
+	newCmd = chunkstrdup(expandBuffer);
 
-	if (alias->name == NULL)
+	if (newCmd == NULL)
 	{
-		free(value);
-		fprintf(stderr, "No memory for alias name\n");
+		fprintf(stderr, "No memory for command\n");
 
-		return;
+		return NULL;
 	}
 
-	strcpy(alias->name, name);
-	alias->value = value;
-	aliasCount++;
+	return newCmd;
 }
 
 
 /*
- * Build aliases for all of the built-in commands which start with a dash,
- * using the names without the dash.
+ * Replace the command substitution at the specified location in a
+ * command being expanded by the output of the command.  The expansion
+ * done so far is saved while the command is run, since the command is
+ * expanded using the same buffer.  Returns the location after the
+ * substitution, or NULL with a message output on an error.
  */
-void
-do_aliasall(int argc, const char **argv)
+static const char *
+substituteCommand(const char * cmd)
 {
-	const CommandEntry *	entry;
-	const char *		name;
-	const char *		newArgv[4];
+	const char *	end;
+	char *		subCmd;
+	char *		saved;
+	char *		output;
+	int		savedLen;
+	int		len;
 
-	for (entry = commandEntryTable; entry->name; entry++)
+	end = endSubstitution(cmd);
+
+	if (end == NULL)
 	{
-		name = entry->name;
+		fprintf(stderr, "Unterminated command substitution\n");
 
-		if (*name != '-')
-			continue;
+		return NULL;
+	}
 
-		newArgv[0] = "alias";
-		newArgv[1] = name + 1;
-		newArgv[2] = name;
-		newArgv[3] = NULL;
+	if (*cmd == '$')
+		cmd++;
 
-		do_alias(3, newArgv);
+	len = end - cmd - 1;
+	subCmd = getChunk(len + 1);
+	savedLen = expandUsed;
+	saved = getChunk(savedLen + 1);
+
+	if ((subCmd == NULL) || (saved == NULL))
+	{
+		fprintf(stderr, "No memory for command\n");
+
+		return NULL;
 	}
+
+	memcpy(subCmd, cmd + 1, len);
+	subCmd[len] = '\0';
+
+	memcpy(saved, expandBuffer, savedLen);
+
+	output = captureCommand(subCmd);
+
+	expandUsed = 0;
+
+	if (!appendExpansion(saved, savedLen))
+		return NULL;
+
+	if (output && !appendExpansion(output, strlen(output)))
+		return NULL;
+
+	return end + 1;
 }
 
 
 /*
- * Look up an alias name, and return a pointer to it.
- * Returns NULL if the name does not exist.
+ * Run a command and capture its standard output for a command
+ * substitution.  If the command is a built-in command, or a pipeline
+ * of them, which only uses streams for its output, then it is run
+ * within this process with its output going into memory.  Otherwise
+ * it is run in a child process whose output is read through a pipe.
+ * The exit status of the command is remembered.  Returns the output
+ * in memory chunks, or NULL with a message output on an error.
  */
-static Alias *
-findAlias(const char * name)
+static char *
+captureCommand(const char * cmd)
 {
-	Alias *	alias;
-	int	count;
+	const char **	stages;
+	FILE *		oldStdout;
+	FILE *		fp;
+	char *		buf;
+	char *		output;
+	size_t		size;
+	pid_t		pid;
+	int		stageCount;
+	int		status;
+	int		fds[2];
+
+	while (isBlank(*cmd))
+		cmd++;
+
+	if (*cmd == '\0')
+		return copyCapture("", 0);
 
-	count = aliasCount;
+	stages = NULL;
+	stageCount = 0;
 
-	for (alias = aliasTable; count-- > 0; alias++)
+	if (streamFlag && !hasOperators(cmd))
 	{
-		if (strcmp(name, alias->name) == 0)
-			return alias;
-	}
+		stages = splitPipeline(cmd, &stageCount);
 
-	return NULL;
-}
+		if (stages == NULL)
+		{
+			lastStatus = 1;
 
+			return NULL;
+		}
 
-void
-do_source(int argc, const char ** argv)
-{
-	readFile(argv[1]);
-}
+		fflush(stdout);
 
+		buf = NULL;
+		size = 0;
+		fp = open_memstream(&buf, &size);
 
-void
-do_exec(int argc, const char ** argv)
-{
-	const char *	name;
+		if (fp == NULL)
+		{
+			perror("open_memstream");
+			lastStatus = 1;
 
-	name = argv[1];
+			return NULL;
+		}
 
-	if (access(name, 4))
-	{
-		perror(name);
+		oldStdout = stdout;
+		stdout = fp;
 
-		return;
+		status = runStreams(stages, stageCount);
+
+		stdout = oldStdout;
+		fclose(fp);
+
+		if (status >= 0)
+		{
+			output = copyCapture(buf, size);
+			free(buf);
+			lastStatus = status;
+
+			return output;
+		}
+
+		free(buf);
 	}
 
-	while (--sourceCount >= 0)
+	if (pipe2(fds, O_CLOEXEC) < 0)
 	{
-		if (sourcefiles[sourceCount] != stdin)
-			fclose(sourcefiles[sourceCount]);
-	}
+		perror("pipe");
+		lastStatus = 1;
 
-	argv[argc] = NULL;
+		return NULL;
+	}
 
-	execvp(name, (char **) argv + 1);
-	exit(1);
-}
+	fflush(stdout);
 
+	/*
+	 * A simple command is started directly, but anything else is run
+	 * by a copy of ourself.
+	 */
+	if (stageCount == 1)
+		pid = startCommand(stages[0], -1, fds[1]);
+	else
+	{
+		pid = fork();
 
-void
-do_prompt(int argc, const char ** argv)
-{
-	char *	cp;
-	char	buf[CMD_LEN];
+		if (pid == 0)
+		{
+			dup2(fds[1], STDOUT);
 
-	if (!makeString(argc - 1, argv + 1, buf, CMD_LEN))
-		return;
+			/*
+			 * The command is copied since running it frees
+			 * the memory chunks.
+			 */
+			status = 1;
 
-	cp = malloc(strlen(buf) + 2);
+			if (stages)
+				status = runStages(cmd, stages, stageCount, FALSE);
+			else if ((cmd = strdup(cmd)) != NULL)
+			{
+				command(cmd);
+				status = lastStatus;
+			}
 
-	if (cp == NULL)
-	{
-		fprintf(stderr, "No memory for prompt\n");
+			fflush(stdout);
+			_exit(status);
+		}
 
-		return;
+		if (pid < 0)
+			perror("fork");
 	}
 
-	strcpy(cp, buf);
-	strcat(cp, " ");
+	close(fds[1]);
 
-	if (prompt)
-		free(prompt);
+	output = readCapture(fds[0]);
 
-	prompt = cp;
+	close(fds[0]);
+
+	lastStatus = (pid > 0) ? waitChild(pid) : 1;
+
+	return output;
 }
 
 
-void
-do_unalias(int argc, const char ** argv)
+/*
+ * Read all of the output of a command from a pipe.
+ * Returns the output in memory chunks, or NULL with a message output
+ * on an error.
+ */
+static char *
+readCapture(int fd)
 {
-	Alias *	alias;
+	char *	buf;
+	char *	newBuf;
+	char *	output;
+	int	size;
+	int	used;
+	int	cc;
 
-	while (--argc > 0)
+	buf = NULL;
+	size = 0;
+	used = 0;
+
+	while (TRUE)
 	{
-		alias = findAlias(*++argv);
+		if (size - used < BUF_SIZE)
+		{
+			newBuf = realloc(buf, size + BUF_SIZE);
 
-		if (alias == NULL)
+			if (newBuf == NULL)
+			{
+				fprintf(stderr, "No memory for output\n");
+				free(buf);
+
+				return NULL;
+			}
+
+			buf = newBuf;
+			size += BUF_SIZE;
+		}
+
+		cc = read(fd, buf + used, size - used);
+
+		if ((cc < 0) && (errno == EINTR))
 			continue;
 
-		free(alias->name);
-		free(alias->value);
-		aliasCount--;
-		alias->name = aliasTable[aliasCount].name;
-		alias->value = aliasTable[aliasCount].value;	
+		if (cc <= 0)
+			break;
+
+		used += cc;
 	}
+
+	output = copyCapture(buf, used);
+	free(buf);
+
+	return output;
 }
 
 
 /*
- * Display the prompt string.
+ * Copy the captured output of a command into memory chunks with its
+ * trailing newlines removed and its other newlines changed to spaces,
+ * so that the lines become separate arguments.  Returns NULL with a
+ * message output if there is no memory.
  */
-static void
-showPrompt(void)
+static char *
+copyCapture(const char * buf, int len)
 {
-	const char *	cp;
+	char *	output;
+	int	i;
 
-	cp = "> ";
+	while ((len > 0) && (buf[len - 1] == '\n'))
+		len--;
 
-	if (prompt)
-		cp = prompt;
+	output = getChunk(len + 1);
 
-	write(STDOUT, cp, strlen(cp));
-}	
+	if (output == NULL)
+	{
+		fprintf(stderr, "No memory for output\n");
 
+		return NULL;
+	}
 
-static void
-catchInt(int val)
-{
-	signal(SIGINT, catchInt);
+	for (i = 0; i < len; i++)
+		output[i] = (buf[i] == '\n') ? ' ' : buf[i];
 
-	intFlag = TRUE;
+	output[len] = '\0';
 
-	if (intCrlf)
-		write(STDOUT, "\n", 1);
+	return output;
 }
 
 
-static void
-catchQuit(int val)
+/*
+ * Append text to the buffer used for expanding variables, growing it
+ * as necessary.  Returns FALSE with a message output if there is no
+ * memory.
+ */
+static BOOL
+appendExpansion(const char * str, int len)
 {
-	signal(SIGQUIT, catchQuit);
+	char *	newBuffer;
+	int	newSize;
 
-	intFlag = TRUE;
+	if (expandUsed + len > expandSize)
+	{
+		newSize = expandSize * 2 + len + CMD_LEN;
 
-	if (intCrlf)
-		write(STDOUT, "\n", 1);
+		newBuffer = realloc(expandBuffer, newSize);
+
+		if (newBuffer == NULL)
+		{
+			fprintf(stderr, "No memory for command\n");
+
+			return FALSE;
+		}
+
+		expandBuffer = newBuffer;
+		expandSize = newSize;
+	}
+
+	memcpy(expandBuffer + expandUsed, str, len);
+	expandUsed += len;
+
+	return TRUE;
 }
 
 
 /*
- * Print the usage information and quit.
+ * Return the value of the environment variable whose name is the
+ * specified number of characters of a string, or NULL if it is not set.
  */
-static void
-usage(void)
+static const char *
+findVariable(const char * name, int len)
 {
-	fprintf(stderr, "Stand-alone shell (version %s)\n", version);
-	fprintf(stderr, "\n");
-	fprintf(stderr, "Usage: sash [-a] [-q] [-c command] [-p prompt]\n");
+	extern char **	environ;
+	char **		env;
 
-	exit(1);
-}
+	for (env = environ; *env; env++)
+	{
+		if ((memcmp(*env, name, len) == 0) && ((*env)[len] == '='))
+			return *env + len + 1;
+	}
 
-/*
- * Expand one environment variable: Syntax $(VAR)
- */
-static void
-expandVariable(char * cmd)
-{
-	char	tmp[CMD_LEN];
-	char 	*cp;
-	char	*ep;
-
-	strcpy(tmp, cmd);
-	cp = strstr(tmp, "$(");
-	if (cp) {
-		*cp++ = '\0';
-		strcpy(cmd, tmp);
-		ep = ++cp;
-		while (*ep && (*ep != ')')) ep++;
-		if (*ep == ')') *ep++ = '\0';
-		cp = getenv(cp);
-		if (cp) strcat(cmd, cp);
-		strcat(cmd, ep);
-	}
-	return;
+	return NULL;
 }
 
 /* END CODE */
@@ -9,6 +9,7 @@
 #ifndef	SASH_H
 #define	SASH_H
 
+#include "config.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,7 +19,10 @@
 #include <memory.h>
 #include <malloc.h>
 #include <time.h>
+#include <sys/time.h>
 #include <ctype.h>
+#include <spawn.h>
+#include <dirent.h>
 
 
 #define	PATH_LEN	1024
@@ -27,8 +31,10 @@
 #define	EXPAND_ALLOC	1024
 #define	STDIN		0
 #define	STDOUT		1
+#define	STDERR		2
 #define	MAX_SOURCE	10
 #define	BUF_SIZE	8192
+#define	MAX_REDIRECT	10
 
 
 #define	isBlank(ch)	(((ch) == ' ') || ((ch) == '\t'))
@@ -49,71 +55,147 @@ typedef	int	BOOL;
 #define	TRUE	((BOOL) 1)
 
 
+/*
+ * One redirection of a file descriptor.  The descriptor is either
+ * redirected to the named file opened using the specified flags,
+ * or else it is made a copy of another descriptor.
+ */
+typedef struct
+{
+	int		fd;
+	int		flags;
+	int		dupFd;
+	int		openFd;
+	const char *	fileName;
+} Redirect;
+
+
+/*
+ * The redirections for one command.
+ */
+typedef struct
+{
+	int		count;
+	FILE *		oldStdin;
+	Redirect	redirects[MAX_REDIRECT];
+} RedirectList;
+
+
+/*
+ * A command line which is kept parsed to be run many times.
+ */
+typedef	struct	scriptLine	ScriptLine;
+
+
+/*
+ * The performance counters of a built-in command or of the programs,
+ * and the values of the global counters when a command was started.
+ */
+typedef	struct	stats	Stats;
+
+typedef struct
+{
+	struct timespec	startTime;
+	long		readBytes;
+	long		writeBytes;
+	long		opens;
+	long		chunkPeak;
+} StatsMark;
+
+
+/*
+ * A command which is being traced.
+ */
+typedef struct
+{
+	struct timespec	startTime;
+	char *		text;
+} Trace;
+
+
+/*
+ * One built-in command of a pipeline which is run within this process.
+ */
+typedef struct
+{
+	int		(*func)(int argc, const char ** argv);
+	int		argc;
+	const char **	argv;
+} StreamStage;
+
+
 /*
  * Built-in command functions.
  */
-extern	void	do_alias(int argc, const char ** argv);
-extern	void	do_aliasall(int argc, const char ** argv);
-extern	void	do_cd(int argc, const char ** argv);
-extern	void	do_exec(int argc, const char ** argv);
-extern	void	do_exit(int argc, const char ** argv);
-extern	void	do_prompt(int argc, const char ** argv);
-extern	void	do_source(int argc, const char ** argv);
-extern	void	do_umask(int argc, const char ** argv);
-extern	void	do_unalias(int argc, const char ** argv);
-extern	void	do_help(int argc, const char ** argv);
-extern	void	do_ln(int argc, const char ** argv);
-extern	void	do_cp(int argc, const char ** argv);
-extern	void	do_mv(int argc, const char ** argv);
-extern	void	do_rm(int argc, const char ** argv);
-extern	void	do_chmod(int argc, const char ** argv);
-extern	void	do_mkdir(int argc, const char ** argv);
-extern	void	do_rmdir(int argc, const char ** argv);
-extern	void	do_mknod(int argc, const char ** argv);
-extern	void	do_chown(int argc, const char ** argv);
-extern	void	do_chgrp(int argc, const char ** argv);
-extern	void	do_sum(int argc, const char ** argv);
-extern	void	do_sync(int argc, const char ** argv);
-extern	void	do_printenv(int argc, const char ** argv);
-extern	void	do_more(int argc, const char ** argv);
-extern	void	do_cmp(int argc, const char ** argv);
-extern	void	do_touch(int argc, const char ** argv);
-extern	void	do_ls(int argc, const char ** argv);
-extern	void	do_dd(int argc, const char ** argv);
-extern	void	do_tar(int argc, const char ** argv);
-extern	void	do_ar(int argc, const char ** argv);
-extern	void	do_mount(int argc, const char ** argv);
-extern	void	do_umount(int argc, const char ** argv);
-extern	void	do_setenv(int argc, const char ** argv);
-extern	void	do_pwd(int argc, const char ** argv);
-extern	void	do_echo(int argc, const char ** argv);
-extern	void	do_kill(int argc, const char ** argv);
-extern	void	do_grep(int argc, const char ** argv);
-extern	void	do_file(int argc, const char ** argv);
-extern	void	do_find(int argc, const char ** argv);
-extern	void	do_ed(int argc, const char ** argv);
-extern	void	do_where(int argc, const char ** argv);
+extern	int	do_alias(int argc, const char ** argv);
+extern	int	do_aliasall(int argc, const char ** argv);
+extern	int	do_cd(int argc, const char ** argv);
+extern	int	do_exec(int argc, const char ** argv);
+extern	int	do_exit(int argc, const char ** argv);
+extern	int	do_prompt(int argc, const char ** argv);
+extern	int	do_source(int argc, const char ** argv);
+extern	int	do_umask(int argc, const char ** argv);
+extern	int	do_unalias(int argc, const char ** argv);
+extern	int	do_help(int argc, const char ** argv);
+extern	int	do_ln(int argc, const char ** argv);
+extern	int	do_cp(int argc, const char ** argv);
+extern	int	do_mv(int argc, const char ** argv);
+extern	int	do_rm(int argc, const char ** argv);
+extern	int	do_chmod(int argc, const char ** argv);
+extern	int	do_mkdir(int argc, const char ** argv);
+extern	int	do_rmdir(int argc, const char ** argv);
+extern	int	do_mknod(int argc, const char ** argv);
+extern	int	do_chown(int argc, const char ** argv);
+extern	int	do_chgrp(int argc, const char ** argv);
+extern	int	do_stats(int argc, const char ** argv);
+extern	int	do_sum(int argc, const char ** argv);
+extern	int	do_trace(int argc, const char ** argv);
+extern	int	do_sync(int argc, const char ** argv);
+extern	int	do_printenv(int argc, const char ** argv);
+extern	int	do_more(int argc, const char ** argv);
+extern	int	do_cmp(int argc, const char ** argv);
+extern	int	do_touch(int argc, const char ** argv);
+extern	int	do_ls(int argc, const char ** argv);
+extern	int	do_dd(int argc, const char ** argv);
+extern	int	do_tar(int argc, const char ** argv);
+extern	int	do_ar(int argc, const char ** argv);
+extern	int	do_mount(int argc, const char ** argv);
+extern	int	do_umount(int argc, const char ** argv);
+extern	int	do_setenv(int argc, const char ** argv);
+extern	int	do_pwd(int argc, const char ** argv);
+extern	int	do_echo(int argc, const char ** argv);
+extern	int	do_kill(int argc, const char ** argv);
+extern	int	do_grep(int argc, const char ** argv);
+extern	int	do_file(int argc, const char ** argv);
+extern	int	do_find(int argc, const char ** argv);
+extern	int	do_ed(int argc, const char ** argv);
+extern	int	do_where(int argc, const char ** argv);
+extern	int	do_hash(int argc, const char ** argv);
+extern	int	do_jobs(int argc, const char ** argv);
+extern	int	do_parallel(int argc, const char ** argv);
+extern	int	do_perf(int argc, const char ** argv);
+extern	int	do_wait(int argc, const char ** argv);
 
 #ifdef	HAVE_GZIP
-extern	void	do_gzip(int argc, const char ** argv);
-extern	void	do_gunzip(int argc, const char ** argv);
+extern	int	do_gzip(int argc, const char ** argv);
+extern	int	do_gunzip(int argc, const char ** argv);
 #endif
 
 #ifdef	HAVE_EXT2
-extern	void	do_lsattr(int argc, const char ** argv);
-extern	void	do_chattr(int argc, const char ** argv);
+extern	int	do_lsattr(int argc, const char ** argv);
+extern	int	do_chattr(int argc, const char ** argv);
 #endif
 
 #if	HAVE_LINUX_CHROOT
-extern	void	do_chroot(int argc, const char ** argv);
+extern	int	do_chroot(int argc, const char ** argv);
 #endif
 
 #if	HAVE_LINUX_LOSETUP
-extern	void	do_losetup(int argc, const char ** argv);
+extern	int	do_losetup(int argc, const char ** argv);
 #endif
 
 #if	HAVE_LINUX_PIVOT
-extern	void	do_pivot_root(int argc, const char ** argv);
+extern	int	do_pivot_root(int argc, const char ** argv);
 extern  int pivot_root(const char *new_root, const char *put_old);
 #endif
 
@@ -128,9 +210,69 @@ extern	int		nameSort(const void * p1, const void * p2);
 extern	char *		getChunk(int size);
 extern	char *		chunkstrdup(const char *);
 extern	void		freeChunks(void);
+extern	BOOL		reserveChunks(int size);
 extern	int		fullWrite(int fd, const char * buf, int len);
 extern	int		fullRead(int fd, char * buf, int len);
 extern	BOOL		match(const char * text, const char * pattern);
+extern	unsigned int	hashName(const char * name, int len);
+extern	const char *	findProgram(const char * name);
+extern	const char **	getPathDirs(void);
+extern	void		clearProgramCache(void);
+extern	void		clearDirCache(void);
+
+extern	const char *	takeRedirects
+	(const char * cmd, RedirectList * list);
+
+extern	BOOL	openRedirects(RedirectList * list);
+extern	void	closeRedirects(RedirectList * list);
+extern	BOOL	applyRedirects(RedirectList * list, int * saved);
+
+extern	void	restoreRedirects
+	(RedirectList * list, int * saved, int count);
+
+extern	void	addRedirectActions
+	(const RedirectList * list, posix_spawn_file_actions_t * actions);
+
+extern	void	initJobs(void);
+extern	void	blockJobSignal(BOOL block);
+extern	BOOL	addJob(const char * cmd, const pid_t * pids, int pidCount);
+extern	void	reportJobs(void);
+
+extern	pid_t	startCommand(const char * cmd, int inFd, int outFd);
+extern	int	runArgs(int argc, const char ** argv);
+extern	void	command(const char * cmd);
+extern	const char *	expandVariables(const char * cmd);
+extern	const char *	endSubstitution(const char * cmd);
+extern	BOOL	isBuiltIn(const char * cmd);
+
+extern	ScriptLine *	newScriptLine(const char * text);
+extern	void	runScriptLine(ScriptLine * line);
+extern	void	freeScriptLine(ScriptLine * line);
+
+extern	BOOL	controlCommand(const char * cmd);
+extern	BOOL	controlPending(void);
+extern	void	endControl(BOOL complain);
+extern	BOOL	isFunction(const char * cmd);
+extern	BOOL	runFunction(const char * cmd, int * statusPtr);
+extern	const char *	findParameter(const char * name, int len);
+
+extern	BOOL	isTimed(const char * cmd);
+extern	void	timeCommand(const char * cmd);
+
+extern	Stats *	findStats(const char * name);
+extern	void	startStats(StatsMark * mark);
+extern	void	endStats(Stats * stats, const StatsMark * mark);
+
+extern	BOOL	traceTo(int fd);
+extern	void	startTrace(Trace * trace, const char * cmd);
+extern	void	setTraceText(Trace * trace, const char * cmd);
+extern	void	endTrace(Trace * trace, int status);
+
+extern	int	runServer(const char * path);
+extern	int	runClient(const char * path, const char * cmd);
+
+extern	int	runStreamPipeline
+	(const StreamStage * stages, int count);
 
 extern	const char *	buildName
 	(const char * dirName, const char * fileName);
@@ -141,8 +283,20 @@ extern	BOOL	makeArgs
 extern	BOOL	copyFile
 	(const char * srcName, const char * destName, BOOL setModes);
 
-extern	BOOL	makeString
-	(int argc, const char ** argv, char * buf, int bufLen);
+extern	char *	makeString(int argc, const char ** argv);
+
+extern	const char **	copyArgs(int argc, const char ** argv);
+
+extern	double	timevalDiff
+	(const struct timeval * end, const struct timeval * start);
+
+extern	double	timespecDiff
+	(const struct timespec * end, const struct timespec * start);
+
+extern	int	openFile(const char * name, int flags, mode_t mode);
+extern	FILE *	fopenFile(const char * name, const char * mode);
+extern	DIR *	openDir(const char * name);
+extern	pid_t	waitProcess(pid_t pid, int * statusPtr, int options);
 
 extern	int	expandWildCards
 	(const char * fileNamePattern, const char *** retFileTable);
@@ -154,6 +308,38 @@ extern	int	expandWildCards
  */
 extern	BOOL	intFlag;
 
+/*
+ * The exit status of the last command.
+ */
+extern	int	lastStatus;
+
+/*
+ * The numbers of bytes transferred by fullRead and fullWrite.
+ */
+extern	long	fullReadBytes;
+extern	long	fullWriteBytes;
+
+/*
+ * The number of files opened by openFile, fopenFile, and openDir.
+ */
+extern	long	filesOpened;
+
+/*
+ * The peak resident size of the children which have been waited for.
+ */
+extern	long	childPeakRss;
+
+/*
+ * The number of bytes in memory chunks and its peak value.
+ */
+extern	long	chunkBytes;
+extern	long	chunkPeakBytes;
+
+/*
+ * The file descriptor for tracing commands, or -1 if it is off.
+ */
+extern	int	traceFd;
+
 #endif
 
 /* END CODE */
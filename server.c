@@ -0,0 +1,796 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The command server and its client.  The server listens on a UNIX
+ * domain socket and keeps a pool of forked workers which accept the
+ * commands sent to it.  Each command is run in a new child forked from
+ * a worker, so that running a command does not pay for starting a new
+ * program, and nothing which one command changes, such as aliases or
+ * the umask, is seen by the next one.  The client sends its standard
+ * input, output, and error along with its current directory as
+ * descriptors, so that the output of the command goes straight to
+ * wherever the client's output goes, and then waits for the exit status
+ * of the command.
+ *
+ * A request is an int giving the length of the data which follows it,
+ * with the four descriptors attached.  The data is the command and then
+ * the client's environment strings, each of them null terminated.  The
+ * reply is an int which is the exit status.
+ */
+
+#define	_GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdio_ext.h>
+
+#include "sash.h"
+
+
+#define	REQUEST_FDS	4
+#define	MAX_REQUEST	(16 * 1024 * 1024)
+
+
+static	volatile BOOL	stopFlag;
+static	int		requestFd = -1;
+
+
+static	BOOL	makeAddress(const char * path, struct sockaddr_un * addr);
+static	pid_t	startWorker(int listenFd);
+static	void	runWorker(int listenFd);
+static	void	serveRequest(int fd);
+static	char *	readRequest(int fd, int * fds, int * lenPtr);
+static	void	closeRights(struct msghdr * msg);
+static	BOOL	isServing(const struct sockaddr_un * addr);
+static	BOOL	sendRequest(int fd, const char * cmd);
+static	BOOL	readFully(int fd, char * buf, int len);
+static	BOOL	writeFully(int fd, const char * buf, int len);
+static	void	catchStop(int sig);
+static	void	sendExitStatus(int status, void * arg);
+
+
+/*
+ * Run the command server on the specified socket path until we are
+ * terminated.  Returns the exit status.
+ */
+int
+runServer(const char * path)
+{
+	struct sockaddr_un	addr;
+	struct sigaction	act;
+	struct stat		statBuf;
+	pid_t *			workers;
+	pid_t			pid;
+	mode_t			oldMask;
+	int			workerCount;
+	int			listenFd;
+	int			status;
+	int			i;
+
+	if (!makeAddress(path, &addr))
+		return 1;
+
+	workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (workerCount <= 0)
+		workerCount = 1;
+
+	workers = (pid_t *) calloc(workerCount, sizeof(pid_t));
+
+	if (workers == NULL)
+	{
+		fprintf(stderr, "No memory for workers\n");
+
+		return 1;
+	}
+
+	/*
+	 * Remove a socket left by an earlier server, but not one which
+	 * a server is still listening on.
+	 */
+	if ((lstat(path, &statBuf) == 0) && S_ISSOCK(statBuf.st_mode))
+	{
+		if (isServing(&addr))
+		{
+			fprintf(stderr, "%s: Command server is already running\n",
+				path);
+			free((char *) workers);
+
+			return 1;
+		}
+
+		unlink(path);
+	}
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (listenFd < 0)
+	{
+		perror("socket");
+		free((char *) workers);
+
+		return 1;
+	}
+
+	/*
+	 * Only our own user can connect to the socket, since it runs
+	 * any command which it is given.
+	 */
+	oldMask = umask(077);
+
+	if (bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		perror(path);
+		umask(oldMask);
+		close(listenFd);
+		free((char *) workers);
+
+		return 1;
+	}
+
+	umask(oldMask);
+
+	if (listen(listenFd, SOMAXCONN) < 0)
+	{
+		perror("listen");
+		unlink(path);
+		close(listenFd);
+		free((char *) workers);
+
+		return 1;
+	}
+
+	/*
+	 * The signals which stop the server interrupt its waiting.
+	 */
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = catchStop;
+	sigemptyset(&act.sa_mask);
+
+	sigaction(SIGTERM, &act, NULL);
+	sigaction(SIGINT, &act, NULL);
+	sigaction(SIGHUP, &act, NULL);
+
+	/*
+	 * Keep the pool of workers running, replacing any which die.
+	 */
+	while (!stopFlag)
+	{
+		for (i = 0; !stopFlag && (i < workerCount); i++)
+		{
+			if (workers[i] <= 0)
+				workers[i] = startWorker(listenFd);
+		}
+
+		pid = wait(&status);
+
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == ECHILD)
+			{
+				sleep(1);
+
+				continue;
+			}
+
+			perror("wait");
+
+			break;
+		}
+
+		for (i = 0; i < workerCount; i++)
+		{
+			if (workers[i] == pid)
+				workers[i] = 0;
+		}
+	}
+
+	for (i = 0; i < workerCount; i++)
+	{
+		if (workers[i] > 0)
+			kill(workers[i], SIGTERM);
+	}
+
+	close(listenFd);
+	unlink(path);
+	free((char *) workers);
+
+	return 0;
+}
+
+
+/*
+ * Run a command using the command server on the specified socket path,
+ * as if it had been run by "sash -c".  Returns the exit status of the
+ * command.
+ */
+int
+runClient(const char * path, const char * cmd)
+{
+	struct sockaddr_un	addr;
+	int			fd;
+	int			status;
+
+	if (!makeAddress(path, &addr))
+		return 1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+	{
+		perror("socket");
+
+		return 1;
+	}
+
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		perror(path);
+		close(fd);
+
+		return 1;
+	}
+
+	if (!sendRequest(fd, cmd))
+	{
+		close(fd);
+
+		return 1;
+	}
+
+	/*
+	 * Wait for the exit status.  If the worker died without
+	 * sending one, then the command failed.
+	 */
+	if (!readFully(fd, (char *) &status, sizeof(status)))
+	{
+		fprintf(stderr, "Command server did not reply\n");
+		status = 1;
+	}
+
+	close(fd);
+
+	return status;
+}
+
+
+/*
+ * Make the socket address for a path.
+ * Returns FALSE with a message output if the path is too long.
+ */
+static BOOL
+makeAddress(const char * path, struct sockaddr_un * addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr->sun_path))
+	{
+		fprintf(stderr, "%s: Socket path too long\n", path);
+
+		return FALSE;
+	}
+
+	strcpy(addr->sun_path, path);
+
+	return TRUE;
+}
+
+
+/*
+ * Start a worker process which serves requests from the listening
+ * socket.  Returns its process id, or -1 with a message output if it
+ * could not be started.
+ */
+static pid_t
+startWorker(int listenFd)
+{
+	pid_t	pid;
+
+	fflush(stdout);
+
+	pid = fork();
+
+	if (pid < 0)
+	{
+		perror("fork");
+
+		return -1;
+	}
+
+	if (pid == 0)
+	{
+		/*
+		 * A worker goes away with the server.
+		 */
+		prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+		if (getppid() == 1)
+			_exit(1);
+
+		signal(SIGTERM, SIG_DFL);
+		signal(SIGINT, SIG_DFL);
+		signal(SIGHUP, SIG_DFL);
+
+		runWorker(listenFd);
+		_exit(0);
+	}
+
+	return pid;
+}
+
+
+/*
+ * The main loop of a worker, which accepts connections from clients
+ * and serves their requests one at a time, each in a new child so
+ * that the worker itself is never changed by a command.
+ */
+static void
+runWorker(int listenFd)
+{
+	pid_t	pid;
+	int	status;
+	int	fd;
+
+	while (TRUE)
+	{
+		fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+
+		if (fd < 0)
+		{
+			if ((errno == EINTR) || (errno == ECONNABORTED))
+				continue;
+
+			perror("accept");
+
+			return;
+		}
+
+		fflush(stdout);
+		fflush(stderr);
+
+		pid = fork();
+
+		if (pid < 0)
+		{
+			perror("fork");
+			close(fd);
+
+			continue;
+		}
+
+		if (pid == 0)
+		{
+			close(listenFd);
+
+			/*
+			 * If the command exits, then its client still
+			 * gets its exit status.
+			 */
+			on_exit(sendExitStatus, NULL);
+
+			serveRequest(fd);
+			_exit(0);
+		}
+
+		close(fd);
+
+		while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR))
+			;
+	}
+}
+
+
+/*
+ * Serve one request from a client in the child forked for it.  The
+ * command is run with the client's standard input and output, current
+ * directory, and environment.
+ */
+static void
+serveRequest(int fd)
+{
+	extern char **	environ;
+	char **		env;
+	char *		data;
+	char *		cp;
+	int		fds[REQUEST_FDS];
+	int		count;
+	int		len;
+	int		i;
+
+	data = readRequest(fd, fds, &len);
+
+	if (data == NULL)
+		return;
+
+	/*
+	 * Make the environment from the strings after the command.
+	 */
+	count = 0;
+
+	for (cp = data + strlen(data) + 1; cp < data + len; cp += strlen(cp) + 1)
+		count++;
+
+	env = (char **) malloc(sizeof(char *) * (count + 1));
+
+	if (env == NULL)
+	{
+		fprintf(stderr, "No memory for environment\n");
+		free(data);
+
+		for (i = 0; i < REQUEST_FDS; i++)
+			close(fds[i]);
+
+		return;
+	}
+
+	count = 0;
+
+	for (cp = data + strlen(data) + 1; cp < data + len; cp += strlen(cp) + 1)
+		env[count++] = cp;
+
+	env[count] = NULL;
+
+	environ = env;
+
+	if (fchdir(fds[3]) < 0)
+		perror("fchdir");
+
+	fflush(stdout);
+	fflush(stderr);
+
+	dup2(fds[0], STDIN);
+	dup2(fds[1], STDOUT);
+	dup2(fds[2], STDERR);
+
+	for (i = 0; i < REQUEST_FDS; i++)
+		close(fds[i]);
+
+	__fpurge(stdin);
+	clearerr(stdin);
+
+	requestFd = fd;
+	intFlag = FALSE;
+	lastStatus = 0;
+
+	command(data);
+	endControl(TRUE);
+
+	fflush(stdout);
+	fflush(stderr);
+
+	requestFd = -1;
+
+	writeFully(fd, (const char *) &lastStatus, sizeof(lastStatus));
+}
+
+
+/*
+ * Read a request from a client along with its descriptors.
+ * Returns the data of the request, which is null terminated, or NULL
+ * if the request is bad.
+ */
+static char *
+readRequest(int fd, int * fds, int * lenPtr)
+{
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr *cmsg;
+	char *		data;
+	int		len;
+	int		cc;
+	union
+	{
+		struct cmsghdr	align;
+		char		buf[CMSG_SPACE(sizeof(int) * REQUEST_FDS)];
+	} control;
+
+	memset(&msg, 0, sizeof(msg));
+
+	iov.iov_base = &len;
+	iov.iov_len = sizeof(len);
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	do
+		cc = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+	while ((cc < 0) && (errno == EINTR));
+
+	if (cc < 0)
+		return NULL;
+
+	/*
+	 * There must be exactly the descriptors which are expected.
+	 * Any others which were received are closed.
+	 */
+	cmsg = CMSG_FIRSTHDR(&msg);
+
+	if ((cmsg == NULL) || (cmsg->cmsg_level != SOL_SOCKET) ||
+		(cmsg->cmsg_type != SCM_RIGHTS) ||
+		(cmsg->cmsg_len != CMSG_LEN(sizeof(int) * REQUEST_FDS)) ||
+		(CMSG_NXTHDR(&msg, cmsg) != NULL) ||
+		(msg.msg_flags & MSG_CTRUNC))
+	{
+		closeRights(&msg);
+
+		return NULL;
+	}
+
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * REQUEST_FDS);
+
+	data = NULL;
+
+	if ((cc == sizeof(len)) && (len > 0) && (len <= MAX_REQUEST))
+		data = malloc(len + 1);
+
+	if (data && readFully(fd, data, len) && (data[len - 1] == '\0'))
+	{
+		data[len] = '\0';
+		*lenPtr = len;
+
+		return data;
+	}
+
+	free(data);
+
+	for (cc = 0; cc < REQUEST_FDS; cc++)
+		close(fds[cc]);
+
+	return NULL;
+}
+
+
+/*
+ * Close all of the descriptors which were received in a message.
+ */
+static void
+closeRights(struct msghdr * msg)
+{
+	struct cmsghdr *cmsg;
+	int		fd;
+	int		count;
+	int		i;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		if ((cmsg->cmsg_level != SOL_SOCKET) ||
+			(cmsg->cmsg_type != SCM_RIGHTS))
+		{
+			continue;
+		}
+
+		count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+		for (i = 0; i < count; i++)
+		{
+			memcpy(&fd, CMSG_DATA(cmsg) + sizeof(int) * i,
+				sizeof(int));
+
+			close(fd);
+		}
+	}
+}
+
+
+/*
+ * Check whether a server is listening on a socket by connecting to it.
+ * Returns TRUE if the connection is accepted.
+ */
+static BOOL
+isServing(const struct sockaddr_un * addr)
+{
+	int	fd;
+	int	rc;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+		return FALSE;
+
+	rc = connect(fd, (const struct sockaddr *) addr, sizeof(*addr));
+
+	close(fd);
+
+	return (rc == 0);
+}
+
+
+/*
+ * Send a request for a command to the server, including our standard
+ * input and output, current directory, and environment.
+ * Returns FALSE with a message output on an error.
+ */
+static BOOL
+sendRequest(int fd, const char * cmd)
+{
+	extern char **	environ;
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr *cmsg;
+	char **		env;
+	char *		data;
+	char *		cp;
+	int		fds[REQUEST_FDS];
+	int		len;
+	int		cc;
+	union
+	{
+		struct cmsghdr	align;
+		char		buf[CMSG_SPACE(sizeof(int) * REQUEST_FDS)];
+	} control;
+
+	len = strlen(cmd) + 1;
+
+	for (env = environ; *env; env++)
+		len += strlen(*env) + 1;
+
+	data = malloc(sizeof(int) + len);
+
+	if (data == NULL)
+	{
+		fprintf(stderr, "No memory for request\n");
+
+		return FALSE;
+	}
+
+	memcpy(data, &len, sizeof(int));
+	cp = data + sizeof(int);
+
+	strcpy(cp, cmd);
+	cp += strlen(cp) + 1;
+
+	for (env = environ; *env; env++)
+	{
+		strcpy(cp, *env);
+		cp += strlen(cp) + 1;
+	}
+
+	fds[0] = STDIN;
+	fds[1] = STDOUT;
+	fds[2] = STDERR;
+	fds[3] = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (fds[3] < 0)
+	{
+		perror(".");
+		free(data);
+
+		return FALSE;
+	}
+
+	/*
+	 * The descriptors go with the length, and then the rest of
+	 * the data is written.
+	 */
+	memset(&msg, 0, sizeof(msg));
+	memset(&control, 0, sizeof(control));
+
+	iov.iov_base = data;
+	iov.iov_len = sizeof(int);
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * REQUEST_FDS);
+
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * REQUEST_FDS);
+
+	do
+		cc = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	while ((cc < 0) && (errno == EINTR));
+
+	close(fds[3]);
+
+	if ((cc != sizeof(int)) || !writeFully(fd, data + sizeof(int), len))
+	{
+		perror("Sending request");
+		free(data);
+
+		return FALSE;
+	}
+
+	free(data);
+
+	return TRUE;
+}
+
+
+/*
+ * Read the specified amount of data from a descriptor.
+ * Returns FALSE if it could not all be read.
+ */
+static BOOL
+readFully(int fd, char * buf, int len)
+{
+	int	cc;
+
+	while (len > 0)
+	{
+		cc = read(fd, buf, len);
+
+		if ((cc < 0) && (errno == EINTR))
+			continue;
+
+		if (cc <= 0)
+			return FALSE;
+
+		buf += cc;
+		len -= cc;
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * Write the specified amount of data to a socket.
+ * Returns FALSE if it could not all be written.
+ */
+static BOOL
+writeFully(int fd, const char * buf, int len)
+{
+	int	cc;
+
+	while (len > 0)
+	{
+		cc = send(fd, buf, len, MSG_NOSIGNAL);
+
+		if ((cc < 0) && (errno == EINTR))
+			continue;
+
+		if (cc <= 0)
+			return FALSE;
+
+		buf += cc;
+		len -= cc;
+	}
+
+	return TRUE;
+}
+
+
+static void
+catchStop(int sig)
+{
+	stopFlag = TRUE;
+}
+
+
+/*
+ * Called when a worker exits, so that if it was running a command then
+ * its client gets the exit status.
+ */
+static void
+sendExitStatus(int status, void * arg)
+{
+	if (requestFd < 0)
+		return;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	writeFully(requestFd, (const char *) &status, sizeof(status));
+
+	requestFd = -1;
+}
+
+/* END CODE */
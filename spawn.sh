@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# Benchmark the starting of external programs by timing a script which
+# runs /bin/true many times.  Each sash binary given is timed in turn,
+# so that an older build can be compared with this one.
+#
+# Usage: spawn.sh [sash ...]
+#
+
+LINES=3000
+RUNS=5
+
+tmp=${TMPDIR:-/tmp}/sash-spawn.$$
+trap 'rm -f $tmp' 0
+
+awk -v lines=$LINES 'BEGIN { for (i = 0; i < lines; i++) print "/bin/true" }' > $tmp
+
+for sash in ${*:-./sash}
+do
+	if [ ! -x $sash ]
+	then
+		echo "spawn.sh: $sash has not been built" >&2
+		exit 1
+	fi
+
+	best=
+
+	i=0
+
+	while [ $i -lt $RUNS ]
+	do
+		start=`date +%s%N`
+		$sash -q < $tmp
+		end=`date +%s%N`
+
+		time=`expr \( $end - $start \) / 1000`
+
+		if [ -z "$best" ] || [ $time -lt $best ]
+		then
+			best=$time
+		fi
+
+		i=`expr $i + 1`
+	done
+
+	echo "$sash: $LINES programs in $best microseconds," \
+		"`expr $best / $LINES` microseconds each"
+done
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The table of performance counters which are kept for each built-in
+ * command and for external programs, and the "-stats" built-in command
+ * which shows them.  Files opened are those which the built-in commands
+ * open through openFile, fopenFile, and openDir, and not those which the
+ * C library opens for itself, such as for looking up user names.
+ */
+
+#include "sash.h"
+
+
+/*
+ * The counters for one built-in command or for the programs.
+ */
+struct stats
+{
+	char *	name;
+	long	calls;
+	double	totalTime;
+	double	maxTime;
+	long	readBytes;
+	long	writeBytes;
+	long	opens;
+	long	chunkPeak;
+};
+
+
+static	Stats **	statsTable;
+static	int		statsCount;
+
+
+#if	CMD_STATS
+static	int	statsSort(const void * p1, const void * p2);
+#endif
+
+
+/*
+ * Find the counters with the specified name, adding them to the table
+ * if they are not there yet.  Returns NULL if there is no memory.
+ */
+Stats *
+findStats(const char * name)
+{
+	Stats **	newTable;
+	Stats *		stats;
+	int		i;
+
+	for (i = 0; i < statsCount; i++)
+	{
+		if (strcmp(statsTable[i]->name, name) == 0)
+			return statsTable[i];
+	}
+
+	newTable = (Stats **) realloc((char *) statsTable,
+		sizeof(Stats *) * (statsCount + 1));
+
+	if (newTable == NULL)
+		return NULL;
+
+	statsTable = newTable;
+
+	stats = (Stats *) calloc(1, sizeof(Stats));
+
+	if (stats == NULL)
+		return NULL;
+
+	stats->name = strdup(name);
+
+	if (stats->name == NULL)
+	{
+		free((char *) stats);
+
+		return NULL;
+	}
+
+	statsTable[statsCount++] = stats;
+
+	return stats;
+}
+
+
+/*
+ * Remember the values of the counters at the start of a command.
+ * The peak chunk usage is restarted from the current usage.
+ */
+void
+startStats(StatsMark * mark)
+{
+	clock_gettime(CLOCK_MONOTONIC, &mark->startTime);
+
+	mark->readBytes = fullReadBytes;
+	mark->writeBytes = fullWriteBytes;
+	mark->opens = filesOpened;
+	mark->chunkPeak = chunkPeakBytes;
+
+	chunkPeakBytes = chunkBytes;
+}
+
+
+/*
+ * Add what a command used since its start to its counters, which can
+ * be NULL if they could not be allocated.  The peak chunk usage of
+ * any command running this one includes the peak of this one.
+ */
+void
+endStats(Stats * stats, const StatsMark * mark)
+{
+	struct timespec	now;
+	double		time;
+
+	if (stats)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		time = timespecDiff(&now, &mark->startTime);
+
+		stats->calls++;
+		stats->totalTime += time;
+
+		if (time > stats->maxTime)
+			stats->maxTime = time;
+
+		stats->readBytes += fullReadBytes - mark->readBytes;
+		stats->writeBytes += fullWriteBytes - mark->writeBytes;
+		stats->opens += filesOpened - mark->opens;
+
+		if (chunkPeakBytes > stats->chunkPeak)
+			stats->chunkPeak = chunkPeakBytes;
+	}
+
+	if (mark->chunkPeak > chunkPeakBytes)
+		chunkPeakBytes = mark->chunkPeak;
+}
+
+
+#if	CMD_STATS
+
+int
+do_stats(int argc, const char ** argv)
+{
+	Stats *	stats;
+	int	i;
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "reset") != 0)
+		{
+			fprintf(stderr, "usage: -stats [reset]\n");
+
+			return 1;
+		}
+
+		/*
+		 * The counters are cleared rather than freed since
+		 * they are remembered by the callers.
+		 */
+		for (i = 0; i < statsCount; i++)
+		{
+			stats = statsTable[i];
+
+			stats->calls = 0;
+			stats->totalTime = 0;
+			stats->maxTime = 0;
+			stats->readBytes = 0;
+			stats->writeBytes = 0;
+			stats->opens = 0;
+			stats->chunkPeak = 0;
+		}
+
+		return 0;
+	}
+
+	/*
+	 * Show the commands which took the most time first.
+	 */
+	qsort((void *) statsTable, statsCount, sizeof(Stats *), statsSort);
+
+	printf("%-12s %8s %10s %10s %10s %10s %6s %8s\n",
+		"COMMAND", "CALLS", "TOTAL-MS", "MAX-MS", "READ",
+		"WRITTEN", "OPENS", "CHUNKS");
+
+	for (i = 0; i < statsCount; i++)
+	{
+		stats = statsTable[i];
+
+		if (stats->calls == 0)
+			continue;
+
+		printf("%-12s %8ld %10.3f %10.3f %10ld %10ld %6ld %8ld\n",
+			stats->name, stats->calls, stats->totalTime * 1000,
+			stats->maxTime * 1000, stats->readBytes,
+			stats->writeBytes, stats->opens, stats->chunkPeak);
+	}
+
+	return 0;
+}
+
+#endif
+
+
+#if	CMD_STATS
+
+/*
+ * Sort routine for the counters, putting the largest total time first.
+ */
+static int
+statsSort(const void * p1, const void * p2)
+{
+	const Stats *	s1;
+	const Stats *	s2;
+
+	s1 = *((const Stats * const *) p1);
+	s2 = *((const Stats * const *) p2);
+
+	if (s1->totalTime > s2->totalTime)
+		return -1;
+
+	if (s1->totalTime < s2->totalTime)
+		return 1;
+
+	return strcmp(s1->name, s2->name);
+}
+
+#endif
+
+/* END CODE */
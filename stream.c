@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * Pipelines of built-in commands run within this process.
+ * Each command runs as a coroutine on its own stack, and its standard
+ * output is a stdio stream which writes into a ring buffer which is
+ * read by the standard input stream of the next command.  A command
+ * switches back to the scheduler when it has to wait for its neighbor.
+ */
+
+#define	_GNU_SOURCE
+
+#include <ucontext.h>
+#include <errno.h>
+
+#include "sash.h"
+
+
+#define	RING_SIZE	(64 * 1024)
+#define	STACK_SIZE	(1024 * 1024)
+
+
+/*
+ * The buffer between two commands of a pipeline.
+ */
+typedef struct
+{
+	char *	data;
+	int	head;
+	int	count;
+	BOOL	eof;
+	BOOL	broken;
+} Ring;
+
+
+/*
+ * One command of a pipeline along with its coroutine state.
+ */
+typedef struct
+{
+	const StreamStage *	stage;
+	ucontext_t		context;
+	char *			stack;
+	FILE *			in;
+	FILE *			out;
+	Ring *			inRing;
+	Ring *			outRing;
+	BOOL			started;
+	BOOL			done;
+	BOOL			reading;
+	BOOL			writing;
+	BOOL			intFlag;
+	BOOL			pipeFlag;
+	int			status;
+} Task;
+
+
+static	ucontext_t	schedulerContext;
+static	Task *		currentTask;
+
+
+static	BOOL	isRunnable(const Task * task);
+static	void	resumeTask(Task * task);
+static	void	taskMain(void);
+static	ssize_t	ringRead(void * cookie, char * buf, size_t size);
+static	ssize_t	ringWrite(void * cookie, const char * buf, size_t size);
+static	int	ringCloseRead(void * cookie);
+static	int	ringCloseWrite(void * cookie);
+
+
+static const cookie_io_functions_t	readFunctions =
+{
+	ringRead, NULL, NULL, ringCloseRead
+};
+
+static const cookie_io_functions_t	writeFunctions =
+{
+	NULL, ringWrite, NULL, ringCloseWrite
+};
+
+
+/*
+ * Run a pipeline of built-in commands within this process, connecting
+ * the standard output of each command to the standard input of the next
+ * one.  The first command reads our standard input and the last one
+ * writes our standard output.  Commands with a NULL function just read
+ * and discard their input, and fail.  Returns the exit status of the
+ * last command, or 1 with a message output if the pipeline could not
+ * be started.
+ */
+int
+runStreamPipeline(const StreamStage * stages, int count)
+{
+	FILE *	oldStdin;
+	FILE *	oldStdout;
+	Task *	tasks;
+	Ring *	rings;
+	Task *	task;
+	BOOL	interrupted;
+	BOOL	ok;
+	int	status;
+	int	i;
+
+	tasks = (Task *) calloc(count, sizeof(Task));
+	rings = (Ring *) calloc(count, sizeof(Ring));
+
+	if ((tasks == NULL) || (rings == NULL))
+	{
+		fprintf(stderr, "No memory for pipeline\n");
+		free((char *) tasks);
+		free((char *) rings);
+
+		return 1;
+	}
+
+	fflush(stdout);
+
+	oldStdin = stdin;
+	oldStdout = stdout;
+	ok = TRUE;
+
+	/*
+	 * Set up the streams and the stacks for the commands.
+	 */
+	for (i = 0; ok && (i < count); i++)
+	{
+		task = &tasks[i];
+
+		task->stage = &stages[i];
+		task->in = oldStdin;
+		task->out = oldStdout;
+
+		if (i > 0)
+		{
+			task->inRing = &rings[i - 1];
+			task->in = fopencookie(task, "r", readFunctions);
+		}
+
+		if (i < count - 1)
+		{
+			task->outRing = &rings[i];
+			task->outRing->data = malloc(RING_SIZE);
+
+			if (task->outRing->data)
+				task->out = fopencookie(task, "w", writeFunctions);
+			else
+				task->out = NULL;
+		}
+
+		task->stack = malloc(STACK_SIZE);
+
+		if ((task->in == NULL) || (task->out == NULL) ||
+			(task->stack == NULL) || (getcontext(&task->context) < 0))
+		{
+			fprintf(stderr, "No memory for pipeline\n");
+			ok = FALSE;
+
+			break;
+		}
+
+		task->context.uc_stack.ss_sp = task->stack;
+		task->context.uc_stack.ss_size = STACK_SIZE;
+		task->context.uc_link = &schedulerContext;
+
+		makecontext(&task->context, taskMain, 0);
+	}
+
+	/*
+	 * Keep running the command nearest the end of the pipeline which
+	 * can make progress until all of them have finished.  Giving the
+	 * later commands priority keeps the buffers from filling up.
+	 */
+	while (ok)
+	{
+		task = NULL;
+
+		for (i = count - 1; i >= 0; i--)
+		{
+			if (isRunnable(&tasks[i]))
+			{
+				task = &tasks[i];
+
+				break;
+			}
+		}
+
+		if (task == NULL)
+			break;
+
+		resumeTask(task);
+	}
+
+	/*
+	 * Clean up.  A command only sees an interrupt if it was a real one
+	 * and not just because the command after it stopped reading.
+	 */
+	interrupted = FALSE;
+
+	for (i = 0; i < count; i++)
+	{
+		rings[i].eof = TRUE;
+		rings[i].broken = TRUE;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		task = &tasks[i];
+
+		if (task->intFlag && !task->pipeFlag)
+			interrupted = TRUE;
+
+		if (!task->done)
+		{
+			if (task->inRing && task->in)
+				fclose(task->in);
+
+			if (task->outRing && task->out)
+				fclose(task->out);
+		}
+
+		free(task->stack);
+		free(rings[i].data);
+	}
+
+	stdin = oldStdin;
+	stdout = oldStdout;
+	intFlag = interrupted;
+
+	status = ok ? tasks[count - 1].status : 1;
+
+	free((char *) tasks);
+	free((char *) rings);
+
+	return status;
+}
+
+
+/*
+ * Return TRUE if a command of a pipeline can make progress.
+ */
+static BOOL
+isRunnable(const Task * task)
+{
+	if (task->done)
+		return FALSE;
+
+	if (task->reading)
+		return (task->inRing->count > 0) || task->inRing->eof;
+
+	if (task->writing)
+	{
+		return (task->outRing->count < RING_SIZE) ||
+			task->outRing->broken;
+	}
+
+	return TRUE;
+}
+
+
+/*
+ * Switch to a command of a pipeline until it finishes or has to wait,
+ * with the standard streams and interrupt flag set up for it.
+ */
+static void
+resumeTask(Task * task)
+{
+	FILE *	oldStdin;
+	FILE *	oldStdout;
+
+	oldStdin = stdin;
+	oldStdout = stdout;
+
+	currentTask = task;
+	stdin = task->in;
+	stdout = task->out;
+	intFlag = task->intFlag;
+
+	task->started = TRUE;
+
+	swapcontext(&schedulerContext, &task->context);
+
+	task->intFlag = intFlag;
+
+	currentTask = NULL;
+	stdin = oldStdin;
+	stdout = oldStdout;
+}
+
+
+/*
+ * The body of the coroutine for one command of a pipeline.
+ * When this returns, the scheduler is resumed.
+ */
+static void
+taskMain(void)
+{
+	Task *	task;
+	char	buf[BUF_SIZE];
+
+	task = currentTask;
+	task->status = 1;
+
+	if (task->stage->func)
+		task->status = task->stage->func(task->stage->argc,
+			task->stage->argv);
+	else if (task->inRing)
+	{
+		while (fread(buf, 1, sizeof(buf), stdin) > 0)
+			;
+	}
+
+	/*
+	 * Closing the streams tells the neighboring commands that
+	 * there is no more output or that no more input is wanted.
+	 */
+	if (task->outRing)
+		fclose(task->out);
+	else
+		fflush(stdout);
+
+	if (task->inRing)
+		fclose(task->in);
+
+	task->done = TRUE;
+}
+
+
+/*
+ * Read data from the ring buffer before a command, waiting for the
+ * previous command to write some if it is empty.
+ */
+static ssize_t
+ringRead(void * cookie, char * buf, size_t size)
+{
+	Task *	task;
+	Ring *	ring;
+	int	len;
+	int	part;
+
+	task = (Task *) cookie;
+	ring = task->inRing;
+
+	while ((ring->count == 0) && !ring->eof)
+	{
+		task->reading = TRUE;
+		swapcontext(&task->context, &schedulerContext);
+		task->reading = FALSE;
+	}
+
+	len = MIN(ring->count, (int) size);
+	part = MIN(len, RING_SIZE - ring->head);
+
+	memcpy(buf, ring->data + ring->head, part);
+	memcpy(buf + part, ring->data, len - part);
+
+	ring->head = (ring->head + len) % RING_SIZE;
+	ring->count -= len;
+
+	return len;
+}
+
+
+/*
+ * Write data into the ring buffer after a command, waiting for the
+ * next command to read some if it is full.  If the next command has
+ * finished, then the write fails and the command is interrupted, as
+ * if a separate process had received a SIGPIPE signal.
+ */
+static ssize_t
+ringWrite(void * cookie, const char * buf, size_t size)
+{
+	Task *	task;
+	Ring *	ring;
+	int	tail;
+	int	len;
+	int	part;
+	size_t	total;
+
+	task = (Task *) cookie;
+	ring = task->outRing;
+	total = 0;
+
+	while (total < size)
+	{
+		while ((ring->count == RING_SIZE) && !ring->broken)
+		{
+			task->writing = TRUE;
+			swapcontext(&task->context, &schedulerContext);
+			task->writing = FALSE;
+		}
+
+		if (ring->broken)
+		{
+			task->pipeFlag = TRUE;
+			intFlag = TRUE;
+			errno = EPIPE;
+
+			return -1;
+		}
+
+		tail = (ring->head + ring->count) % RING_SIZE;
+		len = MIN(RING_SIZE - ring->count, (int) (size - total));
+		part = MIN(len, RING_SIZE - tail);
+
+		memcpy(ring->data + tail, buf + total, part);
+		memcpy(ring->data, buf + total + part, len - part);
+
+		ring->count += len;
+		total += len;
+	}
+
+	return total;
+}
+
+
+static int
+ringCloseRead(void * cookie)
+{
+	((Task *) cookie)->inRing->broken = TRUE;
+
+	return 0;
+}
+
+
+static int
+ringCloseWrite(void * cookie)
+{
+	((Task *) cookie)->outRing->eof = TRUE;
+
+	return 0;
+}
+
+/* END CODE */
@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# Benchmark pipelines of built-in commands, which are run within the
+# shell, against the same pipelines run as separate processes by using
+# the -P option.  A script of many small pipelines and one long chain
+# over a large file are timed both ways for each sash binary given.
+# The output goes to /dev/null from outside, since a redirection within
+# a pipeline would itself make it use processes.
+#
+# Usage: stream.sh [sash ...]
+#
+
+PIPELINES=2000
+FILE_LINES=1000000
+RUNS=5
+
+tmp=${TMPDIR:-/tmp}/sash-stream.$$
+trap 'rm -f $tmp.small $tmp.chain $tmp.data' 0
+
+awk -v n=$PIPELINES 'BEGIN {
+	for (i = 0; i < n; i++) print "-echo hello | -grep hello"
+}' > $tmp.small
+
+awk -v n=$FILE_LINES 'BEGIN {
+	for (i = 0; i < n; i++) print "line " i
+}' > $tmp.data
+
+echo "-grep line $tmp.data | -grep 7 | -grep -n 3" > $tmp.chain
+
+#
+# Print the best time in microseconds of running a script with sash.
+#
+best()
+{
+	best=
+
+	i=0
+
+	while [ $i -lt $RUNS ]
+	do
+		start=`date +%s%N`
+		$1 -q $2 < $3 > /dev/null
+		end=`date +%s%N`
+
+		time=`expr \( $end - $start \) / 1000`
+
+		if [ -z "$best" ] || [ $time -lt $best ]
+		then
+			best=$time
+		fi
+
+		i=`expr $i + 1`
+	done
+
+	echo $best
+}
+
+for sash in ${*:-./sash}
+do
+	if [ ! -x $sash ]
+	then
+		echo "stream.sh: $sash has not been built" >&2
+		exit 1
+	fi
+
+	for mode in shell processes
+	do
+		if [ $mode = shell ]
+		then
+			flag=
+		else
+			flag=-P
+		fi
+
+		small=`best $sash "$flag" $tmp.small`
+		chain=`best $sash "$flag" $tmp.chain`
+
+		echo "$sash: in $mode: $PIPELINES small pipelines in" \
+			"$small microseconds, `expr $small / $PIPELINES`" \
+			"microseconds each"
+		echo "$sash: in $mode: chain over $FILE_LINES lines in" \
+			"$chain microseconds"
+	done
+done
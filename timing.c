@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The "time" command, which runs a command line and then reports the
+ * time and other resources that it used, separately for the shell
+ * itself and for the child processes which it ran.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "sash.h"
+
+
+/*
+ * The resource usage at one moment.
+ */
+typedef struct
+{
+	struct timespec	realTime;
+	struct rusage	self;
+	struct rusage	children;
+	long		readBytes;
+	long		writeBytes;
+} Usage;
+
+
+static	void	getUsage(Usage * usage);
+static	BOOL	resetPeakRss(void);
+static	long	getPeakRss(void);
+
+
+/*
+ * Return TRUE if a command line is to be timed, which is when it
+ * begins with the word "time".
+ */
+BOOL
+isTimed(const char * cmd)
+{
+	return ((strncmp(cmd, "time", 4) == 0) &&
+		((cmd[4] == '\0') || isBlank(cmd[4])));
+}
+
+
+/*
+ * Run a command line which begins with the word "time" and report
+ * the resources used by the rest of it on stderr.  The rest of the
+ * line can be anything which can be typed as a command, including
+ * a pipeline.  The exit status is that of the command.
+ */
+void
+timeCommand(const char * cmd)
+{
+	Usage	start;
+	Usage	end;
+	char *	copy;
+	double	realTime;
+	double	selfUser;
+	double	selfSys;
+	double	childUser;
+	double	childSys;
+	long	oldChildPeak;
+	long	childPeak;
+	long	shellPeak;
+	BOOL	peakReset;
+
+	cmd += 4;
+
+	while (isBlank(*cmd))
+		cmd++;
+
+	if (*cmd == '\0')
+	{
+		fprintf(stderr, "usage: time command\n");
+		lastStatus = 1;
+
+		return;
+	}
+
+	/*
+	 * The command can be in memory chunks which are freed when it
+	 * is run, so it needs its own copy.
+	 */
+	copy = strdup(cmd);
+
+	if (copy == NULL)
+	{
+		fprintf(stderr, "No memory for command\n");
+		lastStatus = 1;
+
+		return;
+	}
+
+	/*
+	 * The peak sizes are restarted so that they are for this command
+	 * alone.  The peak size of the children is the largest of the
+	 * children which finish while it runs.
+	 */
+	oldChildPeak = childPeakRss;
+	childPeakRss = 0;
+
+	peakReset = resetPeakRss();
+
+	getUsage(&start);
+
+	command(copy);
+
+	getUsage(&end);
+
+	shellPeak = getPeakRss();
+	childPeak = childPeakRss;
+
+	/*
+	 * Children which were waited for by the C library, such as
+	 * by system, are only known about if one of them set a new
+	 * peak for all of the children.
+	 */
+	if ((end.children.ru_maxrss > start.children.ru_maxrss) &&
+		(end.children.ru_maxrss > childPeak))
+	{
+		childPeak = end.children.ru_maxrss;
+	}
+
+	if (oldChildPeak > childPeakRss)
+		childPeakRss = oldChildPeak;
+
+	free(copy);
+
+	realTime = timespecDiff(&end.realTime, &start.realTime);
+
+	selfUser = timevalDiff(&end.self.ru_utime, &start.self.ru_utime);
+	selfSys = timevalDiff(&end.self.ru_stime, &start.self.ru_stime);
+	childUser = timevalDiff(&end.children.ru_utime,
+		&start.children.ru_utime);
+	childSys = timevalDiff(&end.children.ru_stime,
+		&start.children.ru_stime);
+
+	fflush(stdout);
+
+	fprintf(stderr, "real      %.3fs\n", realTime);
+
+	fprintf(stderr, "user      %.3fs (shell %.3fs, children %.3fs)\n",
+		selfUser + childUser, selfUser, childUser);
+
+	fprintf(stderr, "sys       %.3fs (shell %.3fs, children %.3fs)\n",
+		selfSys + childSys, selfSys, childSys);
+
+	fprintf(stderr, "maxrss    %ld kB shell%s, %ld kB children\n",
+		shellPeak, peakReset ? "" : " (since it started)", childPeak);
+
+	fprintf(stderr, "faults    %ld major, %ld minor\n",
+		(end.self.ru_majflt - start.self.ru_majflt) +
+		(end.children.ru_majflt - start.children.ru_majflt),
+		(end.self.ru_minflt - start.self.ru_minflt) +
+		(end.children.ru_minflt - start.children.ru_minflt));
+
+	fprintf(stderr, "switches  %ld voluntary, %ld involuntary\n",
+		(end.self.ru_nvcsw - start.self.ru_nvcsw) +
+		(end.children.ru_nvcsw - start.children.ru_nvcsw),
+		(end.self.ru_nivcsw - start.self.ru_nivcsw) +
+		(end.children.ru_nivcsw - start.children.ru_nivcsw));
+
+	fprintf(stderr, "blocks    %ld in, %ld out\n",
+		(end.self.ru_inblock - start.self.ru_inblock) +
+		(end.children.ru_inblock - start.children.ru_inblock),
+		(end.self.ru_oublock - start.self.ru_oublock) +
+		(end.children.ru_oublock - start.children.ru_oublock));
+
+	fprintf(stderr, "bytes     %ld read, %ld written\n",
+		end.readBytes - start.readBytes,
+		end.writeBytes - start.writeBytes);
+}
+
+
+/*
+ * Get the current time and resource usage of ourself and of the
+ * child processes which have been waited for.
+ */
+static void
+getUsage(Usage * usage)
+{
+	clock_gettime(CLOCK_MONOTONIC, &usage->realTime);
+	getrusage(RUSAGE_SELF, &usage->self);
+	getrusage(RUSAGE_CHILDREN, &usage->children);
+
+	usage->readBytes = fullReadBytes;
+	usage->writeBytes = fullWriteBytes;
+}
+
+
+/*
+ * Restart the peak resident size of the shell from its current size.
+ * Returns FALSE if the kernel does not allow this.
+ */
+static BOOL
+resetPeakRss(void)
+{
+	int	fd;
+	BOOL	ok;
+
+	fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return FALSE;
+
+	ok = (write(fd, "5", 1) == 1);
+
+	close(fd);
+
+	return ok;
+}
+
+
+/*
+ * Return the peak resident size of the shell in kilobytes since it
+ * was last restarted.
+ */
+static long
+getPeakRss(void)
+{
+	struct rusage	usage;
+	FILE *		fp;
+	char		buf[80];
+	long		peak;
+
+	peak = -1;
+
+	fp = fopen("/proc/self/status", "re");
+
+	if (fp)
+	{
+		while (fgets(buf, sizeof(buf), fp))
+		{
+			if (sscanf(buf, "VmHWM: %ld", &peak) == 1)
+				break;
+		}
+
+		fclose(fp);
+	}
+
+	if (peak >= 0)
+		return peak;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss;
+}
+
+/* END CODE */
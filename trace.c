@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2026 by the sash contributors
+ * Permission is granted to use, distribute, or modify this source,
+ * provided that this copyright notice remains intact.
+ *
+ * The trace of the commands which are run, and the "trace" built-in
+ * command which turns it on and off.  Each command is written to the
+ * trace as one line after it finishes, with the time it started, how
+ * long it took, and its exit status.
+ */
+
+#define	_GNU_SOURCE
+
+#include "sash.h"
+
+
+/*
+ * The lowest file descriptor used for the trace, which keeps it out
+ * of the way of redirections.
+ */
+#define	TRACE_MIN_FD	10
+
+
+/*
+ * The file descriptor which is traced to, or -1 if tracing is off.
+ */
+int	traceFd = -1;
+
+
+static	void	setTraceFd(int fd);
+
+
+/*
+ * Start tracing to a copy of the specified file descriptor.
+ * Returns TRUE if successful.
+ */
+BOOL
+traceTo(int fd)
+{
+	int	newFd;
+
+	newFd = fcntl(fd, F_DUPFD_CLOEXEC, TRACE_MIN_FD);
+
+	if (newFd < 0)
+	{
+		perror("trace");
+
+		return FALSE;
+	}
+
+	setTraceFd(newFd);
+
+	return TRUE;
+}
+
+
+int
+do_trace(int argc, const char ** argv)
+{
+	const char *	cp;
+	int		fd;
+
+	if (strcmp(argv[1], "off") == 0)
+	{
+		if (argc > 2)
+		{
+			fprintf(stderr, "usage: trace on|off [fd | fileName]\n");
+
+			return 1;
+		}
+
+		setTraceFd(-1);
+
+		return 0;
+	}
+
+	if (strcmp(argv[1], "on") != 0)
+	{
+		fprintf(stderr, "usage: trace on|off [fd | fileName]\n");
+
+		return 1;
+	}
+
+	if (argc == 2)
+		return traceTo(STDERR) ? 0 : 1;
+
+	/*
+	 * An argument of only digits is a file descriptor to copy,
+	 * and anything else is a file to append to.
+	 */
+	for (cp = argv[2]; isDecimal(*cp); cp++)
+		;
+
+	if (*cp == '\0')
+		return traceTo(atoi(argv[2])) ? 0 : 1;
+
+	fd = open(argv[2], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+
+	if (fd < 0)
+	{
+		perror(argv[2]);
+
+		return 1;
+	}
+
+	if (!traceTo(fd))
+	{
+		close(fd);
+
+		return 1;
+	}
+
+	close(fd);
+
+	return 0;
+}
+
+
+/*
+ * Start tracing a command by remembering when it started and a copy
+ * of its text.  This is only called when tracing is on.
+ */
+void
+startTrace(Trace * trace, const char * cmd)
+{
+	clock_gettime(CLOCK_MONOTONIC, &trace->startTime);
+
+	trace->text = strdup(cmd);
+}
+
+
+/*
+ * Replace the text of a command being traced with its expanded form.
+ */
+void
+setTraceText(Trace * trace, const char * cmd)
+{
+	free(trace->text);
+
+	trace->text = strdup(cmd);
+}
+
+
+/*
+ * Finish tracing a command by writing its line to the trace if tracing
+ * is still on, and free its text.
+ */
+void
+endTrace(Trace * trace, int status)
+{
+	struct timespec	now;
+	double		duration;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	duration = timespecDiff(&now, &trace->startTime);
+
+	if ((traceFd >= 0) && trace->text)
+	{
+		dprintf(traceFd, "%ld.%06ld %10.6f %3d %s\n",
+			(long) trace->startTime.tv_sec,
+			trace->startTime.tv_nsec / 1000,
+			duration, status, trace->text);
+	}
+
+	free(trace->text);
+	trace->text = NULL;
+}
+
+
+/*
+ * Set the file descriptor which is traced to, closing the old one.
+ * A value of -1 turns tracing off.
+ */
+static void
+setTraceFd(int fd)
+{
+	if (traceFd >= 0)
+		close(traceFd);
+
+	traceFd = fd;
+}
+
+/* END CODE */
@@ -10,6 +10,9 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 #include <dirent.h>
 #include <utime.h>
 
@@ -33,6 +36,76 @@ struct	chunk
 static	CHUNK *	chunkList;
 
 
+/*
+ * The emergency memory which chunks are taken from when malloc fails.
+ * It is all reused once the chunks are freed.
+ */
+static	char *	reserveData;
+static	int	reserveSize;
+static	int	reserveUsed;
+static	BOOL	reserveReported;
+
+
+static	CHUNK *	getReserveChunk(int size);
+
+
+/*
+ * The cached list of the names in a directory, which is valid as long
+ * as the directory has the same device, inode, and times.  The names
+ * are stored one after another, each ending with a null character.
+ */
+#define	DIR_CACHE_SIZE	16
+
+typedef struct
+{
+	BOOL		valid;
+	dev_t		dev;
+	ino_t		ino;
+	struct timespec	mtime;
+	struct timespec	ctime;
+	unsigned long	lastUse;
+	int		count;
+	char *		names;
+} DirCache;
+
+
+static	DirCache	dirCache[DIR_CACHE_SIZE];
+static	unsigned long	dirCacheUse;
+
+
+static	const DirCache *	getDirNames(const char * dirName);
+static	BOOL	readDirNames(const char * dirName, DirCache * entry);
+
+
+/*
+ * The total numbers of bytes read and written by fullRead and fullWrite.
+ */
+long	fullReadBytes;
+long	fullWriteBytes;
+
+
+/*
+ * The total number of files which have been opened by openFile,
+ * fopenFile, and openDir.
+ */
+long	filesOpened;
+
+
+/*
+ * The largest resident set size in kilobytes of the child processes
+ * which have been waited for by waitProcess since it was last reset.
+ */
+long	childPeakRss;
+
+
+/*
+ * The number of bytes in chunks which are now allocated, and the
+ * largest number which has been allocated since it was last reset.
+ */
+long	chunkBytes;
+long	chunkPeakBytes;
+
+
 
 /*
  * Return the standard ls-like mode string from a file mode.
@@ -205,7 +278,7 @@ copyFile(
 		return FALSE;
 	}
 
-	rfd = open(srcName, O_RDONLY);
+	rfd = openFile(srcName, O_RDONLY, 0);
 
 	if (rfd < 0)
 	{
@@ -214,7 +287,8 @@ copyFile(
 		return FALSE;
 	}
 
-	wfd = creat(destName, statBuf1.st_mode);
+	wfd = openFile(destName, O_WRONLY | O_CREAT | O_TRUNC,
+		statBuf1.st_mode);
 
 	if (wfd < 0)
 	{
@@ -276,6 +350,171 @@ error_exit:
 }
 
 
+/*
+ * Return the list of the names of the files in a directory, other than
+ * "." and "..".  The list is cached so that scripts which use wildcards
+ * in the same directory many times only need to stat it after the first
+ * time.  The returned list is only valid until the next call.
+ * Returns NULL with a message output on an error.
+ */
+static const DirCache *
+getDirNames(const char * dirName)
+{
+	DirCache *	entry;
+	struct stat	statBuf;
+	int		i;
+
+	if (stat(dirName, &statBuf) < 0)
+	{
+		perror(dirName);
+
+		return NULL;
+	}
+
+	/*
+	 * Look for the directory in the cache, using it if it has not
+	 * changed, or else replacing it.  If it is not there then the
+	 * least recently used entry is replaced.
+	 */
+	entry = &dirCache[0];
+
+	for (i = 0; i < DIR_CACHE_SIZE; i++)
+	{
+		if (dirCache[i].valid && (dirCache[i].dev == statBuf.st_dev) &&
+			(dirCache[i].ino == statBuf.st_ino))
+		{
+			entry = &dirCache[i];
+
+			break;
+		}
+
+		if (!dirCache[i].valid || (entry->valid &&
+			(dirCache[i].lastUse < entry->lastUse)))
+		{
+			entry = &dirCache[i];
+		}
+	}
+
+	entry->lastUse = ++dirCacheUse;
+
+	if (entry->valid && (entry->dev == statBuf.st_dev) &&
+		(entry->ino == statBuf.st_ino) &&
+		(entry->mtime.tv_sec == statBuf.st_mtim.tv_sec) &&
+		(entry->mtime.tv_nsec == statBuf.st_mtim.tv_nsec) &&
+		(entry->ctime.tv_sec == statBuf.st_ctim.tv_sec) &&
+		(entry->ctime.tv_nsec == statBuf.st_ctim.tv_nsec))
+	{
+		return entry;
+	}
+
+	entry->valid = FALSE;
+
+	if (!readDirNames(dirName, entry))
+		return NULL;
+
+	/*
+	 * The list is only kept if the directory was last changed long
+	 * enough ago that a change within the same tick of the clock as
+	 * that one could not be missed.
+	 */
+	entry->dev = statBuf.st_dev;
+	entry->ino = statBuf.st_ino;
+	entry->mtime = statBuf.st_mtim;
+	entry->ctime = statBuf.st_ctim;
+	entry->valid = (statBuf.st_mtim.tv_sec < time(NULL) - 1);
+
+	return entry;
+}
+
+
+/*
+ * Read the names of the files in a directory into a cache entry,
+ * replacing any names it had.  Returns TRUE if successful, or FALSE
+ * with a message output on an error.
+ */
+static BOOL
+readDirNames(const char * dirName, DirCache * entry)
+{
+	DIR *		dirp;
+	struct dirent *	dp;
+	char *		newNames;
+	int		used;
+	int		size;
+	int		len;
+
+	dirp = openDir(dirName);
+
+	if (dirp == NULL)
+	{
+		perror(dirName);
+
+		return FALSE;
+	}
+
+	free(entry->names);
+	entry->names = NULL;
+	entry->count = 0;
+
+	used = 0;
+	size = 0;
+
+	while ((dp = readdir(dirp)) != NULL)
+	{
+		if ((strcmp(dp->d_name, ".") == 0) ||
+			(strcmp(dp->d_name, "..") == 0))
+		{
+			continue;
+		}
+
+		len = strlen(dp->d_name) + 1;
+
+		if (used + len > size)
+		{
+			size = (used + len) * 2 + BUF_SIZE;
+			newNames = realloc(entry->names, size);
+
+			if (newNames == NULL)
+			{
+				fprintf(stderr, "Cannot allocate file list\n");
+				closedir(dirp);
+
+				return FALSE;
+			}
+
+			entry->names = newNames;
+		}
+
+		memcpy(entry->names + used, dp->d_name, len);
+		used += len;
+		entry->count++;
+	}
+
+	closedir(dirp);
+
+	return TRUE;
+}
+
+
+/*
+ * Forget all of the cached lists of the names in directories.
+ * This is called by the built-in commands which change directories,
+ * so that their changes are always seen.
+ */
+void
+clearDirCache(void)
+{
+	int	i;
+
+	for (i = 0; i < DIR_CACHE_SIZE; i++)
+	{
+		free(dirCache[i].names);
+		dirCache[i].names = NULL;
+		dirCache[i].count = 0;
+		dirCache[i].valid = FALSE;
+	}
+}
+
+
 /*
  * Build a path name from the specified directory name and file name.
  * If the directory name is NULL, then the original fileName is returned.
@@ -320,10 +559,11 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 	const char *	cp1;
 	const char *	cp2;
 	const char *	cp3;
+	const char *	name;
 	char *		str;
-	DIR *		dirp;
-	struct dirent *	dp;
+	const DirCache *	entry;
 	int		dirLen;
+	int		i;
 	int		newFileTableSize;
 	char **		newFileTable;
 	char		dirName[PATH_LEN];
@@ -386,6 +626,13 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 	 * If there was a directory given as part of the file name then
 	 * copy it and null terminate it.
 	 */
+	if (last - fileNamePattern >= PATH_LEN - 1)
+	{
+		fprintf(stderr, "Directory name too long\n");
+
+		return -1;
+	}
+
 	if (last != fileNamePattern)
 	{
 		memcpy(dirName, fileNamePattern, last - fileNamePattern);
@@ -399,16 +646,12 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 	}
 
 	/*
-	 * Open the directory containing the files to be checked.
+	 * Get the names of the files in the directory to be checked.
 	 */
-	dirp = opendir(dirName);
-
-	if (dirp == NULL)
-	{
-		perror(dirName);
+	entry = getDirNames(dirName);
 
+	if (entry == NULL)
 		return -1;
-	}
 
 	/*
 	 * Prepare the directory name for use in making full path names.
@@ -430,21 +673,14 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 	 * Find all of the files in the directory and check them against
 	 * the wildcard pattern.
 	 */
-	while ((dp = readdir(dirp)) != NULL)
-	{
-		/*
-		 * Skip the current and parent directories.
-		 */
-		if ((strcmp(dp->d_name, ".") == 0) ||
-			(strcmp(dp->d_name, "..") == 0))
-		{
-			continue;
-		}
+	name = entry->names;
 
+	for (i = 0; i < entry->count; i++, name += strlen(name) + 1)
+	{
 		/*
 		 * If the file name doesn't match the pattern then skip it.
 		 */
-		if (!match(dp->d_name, last))
+		if (!match(name, last))
 			continue;
 
 		/*
@@ -464,7 +700,6 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 			if (newFileTable == NULL)
 			{
 				fprintf(stderr, "Cannot allocate file list\n");
-				closedir(dirp);
 
 				return -1;
 			}
@@ -476,12 +711,11 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 		/*
 		 * Allocate space for storing the file name in a chunk.
 		 */
-		str = getChunk(dirLen + strlen(dp->d_name) + 1);
+		str = getChunk(dirLen + strlen(name) + 1);
 
 		if (str == NULL)
 		{
 			fprintf(stderr, "No memory for file name\n");
-			closedir(dirp);
 
 			return -1;
 		}
@@ -492,7 +726,7 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 		if (dirLen)
 			memcpy(str, dirName, dirLen);
 
-		strcpy(str + dirLen, dp->d_name);
+		strcpy(str + dirLen, name);
 
 		/*
 		 * Save the allocated file name into the file table.
@@ -501,10 +735,8 @@ expandWildCards(const char * fileNamePattern, const char *** retFileTable)
 	}
 
 	/*
-	 * Close the directory and check for any matches.
+	 * Check for any matches.
 	 */
-	closedir(dirp);
-
 	if (fileCount == 0)
 	{
 		fprintf(stderr, "No matches\n");
@@ -880,7 +1112,7 @@ makeArgs(const char * cmd, int * retArgc, const char *** retArgv)
 		 */
 		if (argCount + fileCount >= argTableSize)
 		{
-			newArgTableSize = argCount + fileCount + 1;
+			newArgTableSize = (argCount + fileCount) * 2 + 1;
 
 			newArgTable = (const char **) realloc(argTable,
 				(sizeof(const char *) * newArgTableSize));
@@ -920,47 +1152,111 @@ makeArgs(const char * cmd, int * retArgc, const char *** retArgv)
 }
 
 
+/*
+ * Copy an argument list into one block of memory with the strings
+ * following the pointers, so that it stays valid when memory chunks
+ * are freed and can be freed itself with one call to free.
+ * Returns NULL with a message output if there is no memory.
+ */
+const char **
+copyArgs(int argc, const char ** argv)
+{
+	const char **	newArgv;
+	char *		cp;
+	int		len;
+	int		i;
+
+	len = sizeof(char *) * (argc + 1);
+
+	for (i = 0; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+
+	newArgv = (const char **) malloc(len);
+
+	if (newArgv == NULL)
+	{
+		fprintf(stderr, "No memory for arg list\n");
+
+		return NULL;
+	}
+
+	cp = (char *) &newArgv[argc + 1];
+
+	for (i = 0; i < argc; i++)
+	{
+		strcpy(cp, argv[i]);
+		newArgv[i] = cp;
+		cp += strlen(cp) + 1;
+	}
+
+	newArgv[argc] = NULL;
+
+	return newArgv;
+}
+
+
 /*
  * Make a NULL-terminated string out of an argc, argv pair.
- * Returns TRUE if successful, or FALSE if the string is too long,
- * with an error message given.  This does not handle spaces within
+ * Returns the string in memory chunks, or NULL with an error message
+ * given if there is no memory.  This does not handle spaces within
  * arguments correctly.
  */
-BOOL
-makeString(
-	int		argc,
-	const char **	argv,
-	char *		buf,
-	int		bufLen
-)
+char *
+makeString(int argc, const char ** argv)
 {
+	char *	str;
+	char *	cp;
 	int	len;
+	int	i;
 
-	while (argc-- > 0)
-	{
-		len = strlen(*argv);
+	len = 1;
 
-		if (len >= bufLen)
-		{
-			fprintf(stderr, "Argument string too long\n");
+	for (i = 0; i < argc; i++)
+		len += strlen(argv[i]) + 1;
 
-			return FALSE;
-		}
+	str = getChunk(len);
 
-		strcpy(buf, *argv++);
+	if (str == NULL)
+	{
+		fprintf(stderr, "No memory for argument string\n");
 
-		buf += len;
-		bufLen -= len;
+		return NULL;
+	}
 
-		if (argc)
-			*buf++ = ' ';
+	cp = str;
 
-		bufLen--; 
+	for (i = 0; i < argc; i++)
+	{
+		if (i > 0)
+			*cp++ = ' ';
+
+		strcpy(cp, argv[i]);
+		cp += strlen(cp);
 	}
 
-	*buf = '\0';
+	*cp = '\0';
 
-	return TRUE;
+	return str;
+}
+
+
+/*
+ * Hash a name of the specified length using the FNV-1a algorithm.
+ */
+unsigned int
+hashName(const char * name, int len)
+{
+	unsigned int	hash;
+
+	hash = 2166136261U;
+
+	while (len-- > 0)
+	{
+		hash ^= (unsigned char) *name++;
+		hash *= 16777619U;
+	}
+
+	return hash;
 }
 
 
@@ -980,12 +1276,20 @@ getChunk(int size)
 
 	chunk = (CHUNK *) malloc(size + sizeof(CHUNK) - CHUNK_INIT_SIZE);
 
+	if (chunk == NULL)
+		chunk = getReserveChunk(size + sizeof(CHUNK) - CHUNK_INIT_SIZE);
+
 	if (chunk == NULL)
 		return NULL;
 
 	chunk->next = chunkList;
 	chunkList = chunk;
 
+	chunkBytes += size;
+
+	if (chunkBytes > chunkPeakBytes)
+		chunkPeakBytes = chunkBytes;
+
 	return chunk->data;
 }
 
@@ -1024,8 +1328,65 @@ freeChunks(void)
 	{
 		chunk = chunkList;
 		chunkList = chunk->next;
-		free((char *) chunk);
+
+		if (((char *) chunk < reserveData) ||
+			((char *) chunk >= reserveData + reserveSize))
+		{
+			free((char *) chunk);
+		}
+	}
+
+	chunkBytes = 0;
+	reserveUsed = 0;
+	reserveReported = FALSE;
+}
+
+
+/*
+ * Set aside emergency memory of the specified size which chunks are
+ * allocated from when malloc fails.  The memory is touched so that it
+ * is really present.  Returns TRUE if successful.
+ */
+BOOL
+reserveChunks(int size)
+{
+	reserveData = malloc(size);
+
+	if (reserveData == NULL)
+		return FALSE;
+
+	memset(reserveData, 0, size);
+	reserveSize = size;
+	reserveUsed = 0;
+
+	return TRUE;
+}
+
+
+/*
+ * Allocate a chunk from the emergency memory, reporting the first time
+ * this happens for a command.  Returns NULL if there is none left.
+ */
+static CHUNK *
+getReserveChunk(int size)
+{
+	CHUNK *	chunk;
+
+	size = (size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+
+	if (size > reserveSize - reserveUsed)
+		return NULL;
+
+	if (!reserveReported)
+	{
+		fprintf(stderr, "Out of memory: using the emergency reserve\n");
+		reserveReported = TRUE;
 	}
+
+	chunk = (CHUNK *) (reserveData + reserveUsed);
+	reserveUsed += size;
+
+	return chunk;
 }
 
 
@@ -1052,6 +1413,7 @@ fullWrite(int fd, const char * buf, int len)
 		buf += cc;
 		total+= cc;
 		len -= cc;
+		fullWriteBytes += cc;
 	}
 
 	return total;
@@ -1085,9 +1447,88 @@ fullRead(int fd, char * buf, int len)
 		buf += cc;
 		total+= cc;
 		len -= cc;
+		fullReadBytes += cc;
 	}
 
 	return total;
 }
 
+
+/*
+ * Return the difference between two times of day in seconds.
+ */
+double
+timevalDiff(const struct timeval * end, const struct timeval * start)
+{
+	return (end->tv_sec - start->tv_sec) +
+		(end->tv_usec - start->tv_usec) / 1e6;
+}
+
+
+/*
+ * Return the difference between two clock times in seconds.
+ */
+double
+timespecDiff(const struct timespec * end, const struct timespec * start)
+{
+	return (end->tv_sec - start->tv_sec) +
+		(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/*
+ * Open a file as open does, while counting it for the statistics of
+ * the command.  The built-in commands open their files with this.
+ */
+int
+openFile(const char * name, int flags, mode_t mode)
+{
+	filesOpened++;
+
+	return open(name, flags, mode);
+}
+
+
+/*
+ * Open a stdio file as fopen does, while counting it.
+ */
+FILE *
+fopenFile(const char * name, const char * mode)
+{
+	filesOpened++;
+
+	return fopen(name, mode);
+}
+
+
+/*
+ * Open a directory as opendir does, while counting it.
+ */
+DIR *
+openDir(const char * name)
+{
+	filesOpened++;
+
+	return opendir(name);
+}
+
+
+/*
+ * Wait for a child process as waitpid does, while remembering the
+ * largest resident set size of the children which have finished.
+ */
+pid_t
+waitProcess(pid_t pid, int * statusPtr, int options)
+{
+	struct rusage	usage;
+	pid_t		result;
+
+	result = wait4(pid, statusPtr, options, &usage);
+
+	if ((result > 0) && (usage.ru_maxrss > childPeakRss))
+		childPeakRss = usage.ru_maxrss;
+
+	return result;
+}
+
 /* END CODE */